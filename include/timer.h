@@ -0,0 +1,165 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+/*
+ * the one clock of the benchmarks and the stencils, usable from C and C++.
+ *
+ * on x86 with an invariant TSC the clock reads rdtsc, calibrated against CLOCK_MONOTONIC at
+ * timer_init(). everywhere else, with TIMER_NO_TSC defined or with TIMER_BACKEND=monotonic
+ * in the environment it reads clock_gettime(CLOCK_MONOTONIC). timer_init() also measures
+ * the overhead of one reading and the smallest step between two readings, both in seconds,
+ * so results below a microsecond can be judged against them.
+ *
+ *   timer_init();
+ *   uint64_t t_0 = timer_ticks();
+ *   ...
+ *   double seconds = timer_elapsed(t_0, timer_ticks());
+ *
+ * everything is static, so every translation unit that includes this header has its own
+ * timer_state and calibrates it with its own timer_init(). the benchmarks read the clock
+ * from one file each; C programs with several files go through one wrapper such as
+ * stencil/wtime.c instead of including the header everywhere.
+ */
+
+/* clock_gettime and struct timespec, also under -std=c99 */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(TIMER_NO_TSC)
+#define TIMER_HAS_TSC 1
+#include <x86intrin.h>
+#include <cpuid.h>
+#else
+#define TIMER_HAS_TSC 0
+#endif
+
+/* busy time spent comparing the TSC to CLOCK_MONOTONIC */
+#ifndef TIMER_CALIBRATION_NS
+#define TIMER_CALIBRATION_NS 50000000
+#endif
+
+typedef struct
+{
+    int      initialised;
+    int      tsc;                /* 1: rdtsc, 0: clock_gettime(CLOCK_MONOTONIC) */
+    double   seconds_per_tick;
+    uint64_t base;               /* ticks at timer_init(), timer_seconds() counts from here */
+    double   overhead;           /* seconds per reading */
+    double   resolution;         /* smallest nonzero step between readings, in seconds */
+} timer_state_t;
+
+static timer_state_t timer_state;
+
+static inline uint64_t timer_monotonic_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000u + (uint64_t) ts.tv_nsec;
+}
+
+static inline uint64_t timer_ticks(void)
+{
+#if TIMER_HAS_TSC
+    if (timer_state.tsc) {
+        /* no reading before the instructions in front of it have completed */
+        _mm_lfence();
+        return __rdtsc();
+    }
+#endif
+    return timer_monotonic_ns();
+}
+
+static inline double timer_elapsed(uint64_t t_0, uint64_t t_1)
+{
+    return (double) (int64_t) (t_1 - t_0) * timer_state.seconds_per_tick;
+}
+
+/* seconds since timer_init() */
+static inline double timer_seconds(void)
+{
+    return timer_elapsed(timer_state.base, timer_ticks());
+}
+
+static inline const char *timer_name(void)
+{
+    return timer_state.tsc ? "rdtsc" : "clock_gettime(CLOCK_MONOTONIC)";
+}
+
+/* the TSC is only a clock if it ticks at a constant rate through frequency and sleep states */
+static inline int timer_tsc_usable(void)
+{
+#if TIMER_HAS_TSC
+    unsigned int eax, ebx, ecx, edx;
+    const char *backend = getenv("TIMER_BACKEND");
+
+    if (backend && strcmp(backend, "monotonic") == 0)
+        return 0;
+
+    if (__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) && (edx & (1u << 8)))
+        return 1;
+#endif
+    return 0;
+}
+
+/* picks and calibrates the clock, later calls return at once */
+static inline void timer_init(void)
+{
+    const int readings = 1000;
+    uint64_t t_0, t_1, step;
+    int i;
+
+    if (timer_state.initialised)
+        return;
+
+    timer_state.tsc = timer_tsc_usable();
+    timer_state.seconds_per_tick = 1.0e-9;
+
+    if (timer_state.tsc) {
+        uint64_t ns_0, ns_1, tick_0, tick_1;
+
+        tick_0 = timer_ticks();
+        ns_0 = timer_monotonic_ns();
+
+        do ns_1 = timer_monotonic_ns(); while (ns_1 - ns_0 < TIMER_CALIBRATION_NS);
+
+        tick_1 = timer_ticks();
+
+        if (tick_1 > tick_0)
+            timer_state.seconds_per_tick = (ns_1 - ns_0) * 1.0e-9 / (double) (tick_1 - tick_0);
+        else
+            timer_state.tsc = 0;
+    }
+
+    /* overhead: average over back to back readings */
+    t_0 = timer_ticks();
+    for (i = 0; i < readings; i++)
+        timer_ticks();
+    t_1 = timer_ticks();
+
+    timer_state.overhead = timer_elapsed(t_0, t_1) / (readings + 1);
+
+    /* resolution: smallest change seen between consecutive readings */
+    step = UINT64_MAX;
+
+    for (i = 0; i < 100; i++) {
+        t_0 = timer_ticks();
+        do t_1 = timer_ticks(); while (t_1 == t_0);
+
+        if (t_1 - t_0 < step)
+            step = t_1 - t_0;
+    }
+
+    timer_state.resolution = step * timer_state.seconds_per_tick;
+
+    timer_state.base = timer_ticks();
+    timer_state.initialised = 1;
+}
+
+#endif
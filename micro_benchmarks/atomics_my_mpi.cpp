@@ -0,0 +1,115 @@
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <functional>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "my_mpi.hpp"
+#include "atomic_domain.hpp"
+#include "dist_array.hpp"
+#include "mcl.hpp"
+#include "collect_my_mpi.hpp"
+#include "timer.hpp"
+
+// fetch_add throughput of all ranks together, with up to window operations in flight per rank
+double benchmark_atomics(my_mpi &mpi, atomic_domain<long> &ad, global_ptr<long> target, int ops, int window)
+{
+    std::deque<my_future<long>> in_flight;
+
+    mpi.barrier();
+    auto t_0 = bench_clock::now();
+
+    for(int n=0; n<ops; ++n)
+    {
+        if( in_flight.size() == static_cast<std::size_t>(window) )
+        {
+            in_flight.front().wait();
+            in_flight.pop_front();
+        }
+
+        in_flight.push_back(ad.fetch_add(target, 1));
+    }
+
+    for(auto &f : in_flight)
+        f.wait();
+
+    auto t_1 = bench_clock::now();
+    mpi.barrier();
+
+    // the slowest rank determines the aggregate rate
+    std::vector<double> time = { std::chrono::duration<double>(t_1 - t_0).count() };
+    mpi.allreduce(time, [](double a, double b){ return std::max(a, b); });
+
+    return static_cast<double>(ops) * mpi.world_size() / time.front();
+}
+
+int main(int argc, char ** argv)
+{
+    my_mpi mpi;
+
+    int ops = 100000;
+    int max_window = 64;
+
+    if(argc >= 2) ops = std::atoi(argv[1]);
+    if(argc >= 3) max_window = std::atoi(argv[2]);
+
+    const int rank = mpi.rank();
+    const int ranks = mpi.world_size();
+
+    auto metadata = my_mpi_metadata(mpi, "my_mpi_atomics", my_mpi_config());
+    metadata.set("ops", ops);
+    metadata.set("max_window", max_window);
+
+    atomic_domain<long> ad(mpi);
+
+    // a block of ranks+1 counters on every rank: the first one is shared, the others belong to one rank each
+    dist_array<long> counters(mpi, ranks*(ranks+1), distribution_t::block_cyclic(ranks+1));
+    auto contended   = counters[0];                                         // everybody hits the same word on rank 0
+    auto uncontended = counters[((rank+1) % ranks)*(ranks+1) + rank + 1];   // own word on the right neighbour
+
+    if( rank == 0 )
+    {
+        std::cout << "ATOMICS BENCHMARK (fetch_add)" << std::endl;
+        std::cout << "- ranks: " << ranks << ", operations per rank: " << ops << ", windows: [ 1, " << max_window << " ]" << std::endl;
+        std::cout << "- timer: " << timer_description() << std::endl;
+    }
+
+    std::vector<int> windows;
+    std::vector<double> contended_rates;
+    std::vector<double> uncontended_rates;
+
+    for(int window = 1; window <= max_window; window *= 2)
+    {
+        windows.push_back(window);
+        contended_rates.push_back( benchmark_atomics(mpi, ad, contended, ops, window) );
+        uncontended_rates.push_back( benchmark_atomics(mpi, ad, uncontended, ops, window) );
+    }
+
+    // every increment must have arrived exactly once
+    const long expected_contended = static_cast<long>(ops) * ranks * windows.size();
+    const long expected_uncontended = static_cast<long>(ops) * windows.size();
+
+    if( rank == 0 && ad.load(contended).get() != expected_contended )
+        throw std::runtime_error("contended counter is wrong");
+
+    if( ad.load(uncontended).get() != expected_uncontended )
+        throw std::runtime_error("uncontended counter is wrong");
+
+    if( rank == 0 )
+    {
+        std::cout << std::fixed;
+        std::cout << "RESULTS:" << std::endl;
+
+        for(std::size_t i=0; i<windows.size(); ++i)
+        {
+            std::cout << "- window " << windows[i] << ": contended = " << contended_rates[i]/1.0e6 << " Mops/s"
+                      << ", uncontended = " << uncontended_rates[i]/1.0e6 << " Mops/s" << std::endl;
+        }
+
+        write_results("my_mpi_atomics", metadata, {"window", "contended", "uncontended"}, windows, contended_rates, uncontended_rates);
+    }
+
+    mpi.barrier();
+}
@@ -0,0 +1,118 @@
+#ifndef COLLECT_HPP
+#define COLLECT_HPP
+
+#include <vector>
+#include <cstring>
+#include <atomic>
+#include <algorithm>
+#include <string>
+
+#include <unistd.h>
+
+#include <gasnet.h>
+
+#include "options.hpp"
+#include "result_writer.hpp"
+
+#ifndef BARRIER
+#define BARRIER()                                           \
+do {                                                        \
+  gasnet_barrier_notify(0,GASNET_BARRIERFLAG_ANONYMOUS);    \
+  gasnet_barrier_wait(0,GASNET_BARRIERFLAG_ANONYMOUS);      \
+} while (0)
+#endif
+
+// global data for collecting results
+namespace co
+{
+    std::vector<char> gathered;
+    std::atomic<std::size_t> gathered_bytes{ 0 };
+}
+
+const gasnet_handler_t collect_id = 210;
+
+void collect_handler(gasnet_token_t, void *buf, size_t size, int offset)
+{
+    std::memcpy(co::gathered.data() + offset, buf, size);
+    co::gathered_bytes += size;
+}
+
+/*
+ * the size bytes of every rank on root, rank r's at r*size (empty on the other ranks).
+ * collective, every rank has to pass the same number of bytes.
+ */
+std::vector<char> gather_bytes(const void *data, std::size_t size, int root)
+{
+    const int rank = gasnet_mynode();
+    const std::size_t per_message = gasnet_AMMaxMedium();
+
+    if( rank == root ) co::gathered.assign(gasnet_nodes() * size, 0);
+    co::gathered_bytes = 0;
+    BARRIER();
+
+    for(std::size_t first = 0; first < size; first += per_message)
+    {
+        const auto count = std::min(per_message, size - first);
+        gasnet_AMRequestMedium1(root, collect_id, static_cast<char *>(const_cast<void *>(data)) + first, count, rank*size + first);
+    }
+
+    std::vector<char> result;
+
+    if( rank == root )
+    {
+        GASNET_BLOCKUNTIL( co::gathered_bytes == co::gathered.size() );
+        result.swap(co::gathered);
+    }
+
+    BARRIER();
+
+    return result;
+}
+
+// the values of every rank on root, row r holding those of rank r; every rank has to pass the same number
+std::vector<std::vector<double>> gather_results(const std::vector<double> &values, int root)
+{
+    const std::size_t n = values.size();
+    auto bytes = gather_bytes(values.data(), n*sizeof(double), root);
+
+    std::vector<std::vector<double>> result;
+
+    for(gasnet_node_t r=0; gasnet_mynode() == static_cast<gasnet_node_t>(root) && r<gasnet_nodes(); ++r)
+    {
+        result.emplace_back(n);
+        std::memcpy(result.back().data(), bytes.data() + r*n*sizeof(double), n*sizeof(double));
+    }
+
+    return result;
+}
+
+// hostname of every rank on root, for result_metadata_t::set_hosts
+std::vector<std::string> gather_hostnames(int root)
+{
+    char name[256] = {};
+    gethostname(name, sizeof(name) - 1);
+
+    auto bytes = gather_bytes(name, sizeof(name), root);
+
+    std::vector<std::string> result;
+
+    for(gasnet_node_t r=0; gasnet_mynode() == static_cast<gasnet_node_t>(root) && r<gasnet_nodes(); ++r)
+        result.emplace_back(bytes.data() + r*sizeof(name));
+
+    return result;
+}
+
+// metadata of the result files, the hosts are known on root only; extras see result_metadata_t::set_options()
+result_metadata_t gasnet_metadata(const std::string &benchmark, const pingpong_options_t &opt, const std::vector<std::string> &extras, int root)
+{
+    result_metadata_t metadata(benchmark);
+    auto hostnames = gather_hostnames(root);
+
+    metadata.set("conduit", GASNET_CONDUIT_NAME_STR);
+    metadata.set_options(opt, extras);
+    if( gasnet_mynode() == static_cast<gasnet_node_t>(root) ) metadata.set_hosts(hostnames);
+
+    return metadata;
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef COLLECT_MPI_HPP
+#define COLLECT_MPI_HPP
+
+#include <vector>
+#include <string>
+
+#include <mpi.h>
+
+#include "options.hpp"
+#include "result_writer.hpp"
+
+// hostname of every rank, on all ranks
+std::vector<std::string> gather_hostnames_mpi()
+{
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    char name[MPI_MAX_PROCESSOR_NAME] = {};
+    int name_length = 0;
+    MPI_Get_processor_name(name, &name_length);
+
+    std::vector<char> names(size * MPI_MAX_PROCESSOR_NAME);
+    MPI_Allgather(name, MPI_MAX_PROCESSOR_NAME, MPI_CHAR, names.data(), MPI_MAX_PROCESSOR_NAME, MPI_CHAR, MPI_COMM_WORLD);
+
+    std::vector<std::string> result;
+
+    for(int r=0; r<size; ++r)
+        result.emplace_back(names.data() + r*MPI_MAX_PROCESSOR_NAME);
+
+    return result;
+}
+
+// e.g. "MPI 3.1", for result_metadata_t
+std::string mpi_version()
+{
+    return "MPI " + std::to_string(MPI_VERSION) + "." + std::to_string(MPI_SUBVERSION);
+}
+
+// metadata of the result files, extras see result_metadata_t::set_options()
+result_metadata_t mpi_metadata(const std::string &benchmark, const pingpong_options_t &opt, const std::vector<std::string> &extras)
+{
+    result_metadata_t metadata(benchmark);
+
+    metadata.set("conduit", mpi_version());
+    metadata.set_options(opt, extras);
+    metadata.set_hosts(gather_hostnames_mpi());
+
+    return metadata;
+}
+
+#endif
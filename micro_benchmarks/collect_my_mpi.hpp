@@ -0,0 +1,50 @@
+#ifndef COLLECT_MY_MPI_HPP
+#define COLLECT_MY_MPI_HPP
+
+#include <vector>
+#include <string>
+
+#include <gasnet.h>
+
+#include "my_mpi.hpp"
+#include "result_writer.hpp"
+
+const int hostname_id = 900000;     // + rank of the sender
+
+// hostname of every rank on root (empty on the other ranks), for result_metadata_t::set_hosts
+std::vector<std::string> gather_hostnames(my_mpi &mpi, int root)
+{
+    std::vector<std::string> result;
+
+    if( mpi.rank() != root )
+    {
+        mpi.send_data(root, hostname_id + mpi.rank(), mpi.hostename());
+    }
+    else
+    {
+        for(int r=0; r<mpi.world_size(); ++r)
+        {
+            auto name = ( r == root ? std::vector<char>() : mpi.recv_data<char>(hostname_id + r) );
+            result.push_back( r == root ? mpi.hostename() : std::string(name.begin(), name.end()) );
+        }
+    }
+
+    mpi.barrier();
+
+    return result;
+}
+
+// metadata of the result files, the hosts are known on root only
+result_metadata_t my_mpi_metadata(my_mpi &mpi, const std::string &benchmark, const my_mpi_config &config, int root = 0)
+{
+    result_metadata_t metadata(benchmark);
+    auto hostnames = gather_hostnames(mpi, root);
+
+    metadata.set("conduit", GASNET_CONDUIT_NAME_STR);
+    metadata.set("segment_size", config.segment_size);
+    if( mpi.rank() == root ) metadata.set_hosts(hostnames);
+
+    return metadata;
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <gasnet.h>
+#include <vector>
+#include <string>
+
+#include "mcl.hpp"
+#include "result.hpp"
+#include "options.hpp"
+#include "collect.hpp"
+#include "timer.hpp"
+#include "test_collective.hpp"
+
+/*
+ * collective operations on all ranks: GASNet's own barrier and a binomial AM tree for barrier,
+ * broadcast, reduce and all-reduce (sum of doubles). the number of ranks is that of the launch,
+ * the result files carry it, e.g. gasnet_collective_reduce_am_p16.csv.
+ */
+int main(int argc, char ** argv)
+{
+    std::vector<gasnet_handlerentry_t> handlers = {
+        { collect_id,        (void(*)())collect_handler },
+        { tree_up_id,        (void(*)())tree_up_handler },
+        { tree_down_id,      (void(*)())tree_down_handler },
+        { tree_up_data_id,   (void(*)())tree_up_data_handler },
+        { tree_down_data_id, (void(*)())tree_down_data_handler }
+    };
+
+    const std::vector<std::string> all_tests = { "barrier", "barrier_am", "bcast_am", "reduce_am", "allreduce_am" };
+    const std::vector<collective_t> kinds = { collective_t::barrier, collective_t::barrier_am, collective_t::broadcast_am,
+                                              collective_t::reduce_am, collective_t::allreduce_am };
+
+    gasnet_init(&argc, &argv);
+
+    pingpong_options_t defaults;
+    defaults.round_trips = 100;
+    defaults.iterations = 10;
+    pingpong_options_t opt;
+
+    try { opt = parse_options(argc, argv, defaults, all_tests); }
+    catch(std::runtime_error &e)
+    {
+        if( gasnet_mynode() == 0 ) { std::cerr << e.what() << std::endl; print_usage(argv[0], defaults, all_tests); }
+        gasnet_exit(1);
+    }
+
+    if( opt.help )
+    {
+        if( gasnet_mynode() == 0 ) print_usage(argv[0], defaults, all_tests);
+        gasnet_exit(0);
+    }
+
+    gasnet_attach(handlers.data(), handlers.size(), opt.segment_size, 0);
+
+    const int rank = gasnet_mynode();
+    const int nodes = gasnet_nodes();
+    const tree_t tree(rank, nodes);
+
+    const auto metadata = gasnet_metadata("gasnet_collective", opt, {"segment_size"}, 0);
+
+    if( rank == 0 )
+    {
+        std::cout << "COLLECTIVE BENCHMARK" << std::endl;
+        std::cout << "- ranks: " << nodes << ", operations: " << opt.round_trips << ", warmup: " << opt.warmup << ", iterations: " << opt.iterations << std::endl;
+        std::cout << "- timer: " << timer_description() << std::endl;
+    }
+
+    for(std::size_t t=0; t<all_tests.size(); ++t)
+    {
+        if( !opt.has_test(all_tests[t]) )
+            continue;
+
+        // barriers carry no payload
+        const bool barrier = ( kinds[t] == collective_t::barrier || kinds[t] == collective_t::barrier_am );
+        auto sizes = barrier ? std::vector<std::size_t>{ 0 } : opt.sizes(tree_max_size(tree_t(0, nodes), opt.segment_size));
+
+        if( rank == 0 ) std::cout << "- collective " << all_tests[t] << std::endl;
+
+        collective_data_t data;
+
+        for(auto size : sizes)
+        {
+            std::vector<double> times;
+
+            for(int i=0; i<opt.iterations; ++i)
+                times.push_back( benchmark_collective(kinds[t], size, tree, opt) );
+
+            auto rank_times = gather_results({ mc::average(times) }, 0);
+
+            if( rank == 0 )
+            {
+                std::vector<double> averages;
+                for(auto &r : rank_times) averages.push_back(r.front());
+
+                data.add(size, averages);
+            }
+        }
+
+        if( rank == 0 )
+        {
+            std::cout << std::fixed;
+            std::cout << "RESULTS:" << std::endl;
+
+            print_collective(all_tests[t], data);
+            export_collective(opt.output + "gasnet_collective_" + all_tests[t] + "_p" + std::to_string(nodes), metadata, data);
+        }
+    }
+
+    BARRIER();
+    gasnet_exit(0);
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string>
+
+#include <mpi.h>
+#include "mcl.hpp"
+#include "result.hpp"
+#include "options.hpp"
+#include "collect_mpi.hpp"
+#include "timer.hpp"
+
+/*
+ * the MPI counterpart of collective_gasnet.cpp: barrier, broadcast, reduce and all-reduce
+ * (sum of doubles) on MPI_COMM_WORLD, timed the same way
+ */
+enum class collective_t { barrier, broadcast, reduce, allreduce };
+
+// average time of one operation on this rank, barriers run back to back, the rest separated by barriers
+double benchmark(collective_t kind, std::size_t size, const pingpong_options_t &opt)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    const int count = size / sizeof(double);
+    std::vector<double> data(count, rank);
+    std::vector<double> result(count);
+
+    auto operation = [&]()
+    {
+        switch( kind )
+        {
+            case collective_t::barrier:   MPI_Barrier(MPI_COMM_WORLD); break;
+            case collective_t::broadcast: MPI_Bcast(data.data(), count, MPI_DOUBLE, 0, MPI_COMM_WORLD); break;
+            case collective_t::reduce:    MPI_Reduce(data.data(), result.data(), count, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD); break;
+            case collective_t::allreduce: MPI_Allreduce(data.data(), result.data(), count, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD); break;
+        }
+    };
+
+    for(int n=0; n<opt.warmup; ++n)
+    {
+        MPI_Barrier(MPI_COMM_WORLD);
+        operation();
+    }
+
+    double time = 0.0;
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    if( kind == collective_t::barrier )
+    {
+        auto t_0 = timer_seconds();
+
+        for(int n=0; n<opt.round_trips; ++n)
+            operation();
+
+        time = timer_seconds() - t_0;
+    }
+    else
+    {
+        for(int n=0; n<opt.round_trips; ++n)
+        {
+            MPI_Barrier(MPI_COMM_WORLD);
+            auto t_0 = timer_seconds();
+
+            operation();
+
+            time += timer_seconds() - t_0;
+        }
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    return time / opt.round_trips;
+}
+
+int main(int argc, char ** argv)
+{
+    MPI_Init(&argc, &argv);
+
+    const std::vector<std::string> all_tests = { "barrier", "bcast", "reduce", "allreduce" };
+    const std::vector<collective_t> kinds = { collective_t::barrier, collective_t::broadcast, collective_t::reduce, collective_t::allreduce };
+
+    pingpong_options_t defaults;
+    defaults.round_trips = 100;
+    defaults.iterations = 10;
+    defaults.max_size = 1024 * 1024; // ca. 1 MB
+
+    int rank, size;
+
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    pingpong_options_t opt;
+
+    try { opt = parse_options(argc, argv, defaults, all_tests); }
+    catch(std::runtime_error &e)
+    {
+        if( rank == 0 ) { std::cerr << e.what() << std::endl; print_usage(argv[0], defaults, all_tests); }
+        MPI_Finalize();
+        return 1;
+    }
+
+    if( opt.help )
+    {
+        if( rank == 0 ) print_usage(argv[0], defaults, all_tests);
+        MPI_Finalize();
+        return 0;
+    }
+
+    const auto metadata = mpi_metadata("mpi_collective", opt, {});
+
+    if( rank == 0 )
+    {
+        std::cout << "COLLECTIVE BENCHMARK" << std::endl;
+        std::cout << "- ranks: " << size << ", operations: " << opt.round_trips << ", warmup: " << opt.warmup << ", iterations: " << opt.iterations << std::endl;
+        std::cout << "- timer: " << timer_description() << std::endl;
+    }
+
+    for(std::size_t t=0; t<all_tests.size(); ++t)
+    {
+        if( !opt.has_test(all_tests[t]) )
+            continue;
+
+        auto sizes = kinds[t] == collective_t::barrier ? std::vector<std::size_t>{ 0 } : opt.sizes(opt.max_size);
+
+        if( rank == 0 ) std::cout << "- collective " << all_tests[t] << std::endl;
+
+        collective_data_t data;
+
+        for(auto message_size : sizes)
+        {
+            std::vector<double> times;
+
+            for(int i=0; i<opt.iterations; ++i)
+                times.push_back( benchmark(kinds[t], message_size, opt) );
+
+            double average = mc::average(times);
+            std::vector<double> rank_times(rank == 0 ? size : 0);
+            MPI_Gather(&average, 1, MPI_DOUBLE, rank_times.data(), 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+            if( rank == 0 )
+                data.add(message_size, rank_times);
+        }
+
+        if( rank == 0 )
+        {
+            std::cout << std::fixed;
+            std::cout << "RESULTS:" << std::endl;
+
+            print_collective(all_tests[t], data);
+            export_collective(opt.output + "mpi_collective_" + all_tests[t] + "_p" + std::to_string(size), metadata, data);
+        }
+    }
+
+    MPI_Finalize();
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <functional>
+
+#include "my_mpi.hpp"
+#include "dist_hash_map.hpp"
+#include "mcl.hpp"
+#include "collect_my_mpi.hpp"
+#include "timer.hpp"
+
+// k-mer counting like workload: every rank adds 1 for random keys out of a shared key range
+int main(int argc, char ** argv)
+{
+    my_mpi mpi;
+
+    long updates = 1000000;
+    std::uint64_t key_range = 1 << 22;
+
+    if(argc >= 2) updates = std::atol(argv[1]);
+    if(argc >= 3) key_range = std::atol(argv[2]);
+
+    const int rank = mpi.rank();
+    const int ranks = mpi.world_size();
+
+    auto metadata = my_mpi_metadata(mpi, "my_mpi_hashmap", my_mpi_config());
+    metadata.set("updates", updates);
+    metadata.set("key_range", key_range);
+
+    if( rank == 0 )
+    {
+        std::cout << "HASH MAP BENCHMARK" << std::endl;
+        std::cout << "- ranks: " << ranks << ", updates per rank: " << updates << ", keys: " << key_range << std::endl;
+        std::cout << "- timer: " << timer_description() << std::endl;
+    }
+
+    std::mt19937_64 rng(rank);
+    std::uniform_int_distribution<std::uint64_t> random_key(0, key_range - 1);
+
+    std::vector<std::uint64_t> keys(updates);
+    for(auto &k : keys) k = random_key(rng);
+
+    dist_hash_map<std::uint64_t, long> counts(mpi);
+
+    // updates
+    mpi.barrier();
+    auto t_0 = bench_clock::now();
+
+    for(auto k : keys)
+        counts.update(k, 1);
+
+    counts.flush();
+    mpi.barrier();
+    auto t_1 = bench_clock::now();
+
+    // lookups of the same keys, all in flight at once
+    std::vector<my_future<dist_hash_map<std::uint64_t, long>::lookup_t>> results;
+    results.reserve(keys.size());
+
+    mpi.barrier();
+    auto t_2 = bench_clock::now();
+
+    for(auto k : keys)
+        results.push_back(counts.find(k));
+
+    counts.flush();
+    mpi.barrier();
+    auto t_3 = bench_clock::now();
+
+    // every update must have been counted exactly once and every key must be found
+    std::vector<long> total = { 0 };
+    for(auto &entry : counts.local()) total.front() += entry.second;
+    mpi.allreduce(total, std::plus<long>());
+
+    if( total.front() != updates * ranks )
+        throw std::runtime_error("lost updates in the hash map");
+
+    for(auto &r : results)
+        if( !r.get().found )
+            throw std::runtime_error("key not found in the hash map");
+
+    const double update_rate = updates / std::chrono::duration<double>(t_1 - t_0).count();
+    const double lookup_rate = updates / std::chrono::duration<double>(t_3 - t_2).count();
+
+    std::vector<double> update_rates = { update_rate };
+    std::vector<double> lookup_rates = { lookup_rate };
+
+    if( rank == 0 )
+    {
+        std::cout << std::fixed;
+        std::cout << "RESULTS:" << std::endl;
+        std::cout << "- updates per rank = " << update_rate/1.0e6 << " M/s" << std::endl;
+        std::cout << "- lookups per rank = " << lookup_rate/1.0e6 << " M/s" << std::endl;
+
+        write_results("my_mpi_hashmap", metadata, {"updates", "lookups"}, update_rates, lookup_rates);
+    }
+
+    mpi.barrier();
+}
@@ -0,0 +1,137 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
+/*
+ * log-bucketed latency histogram in the style of HdrHistogram: values below 2^precision ns
+ * are counted exactly, larger ones in 2^(precision-1) buckets per power of two, so every
+ * bucket is narrower than 2^(1-precision) of its value (< 1.6 % for the default of 7).
+ * recording is an increment, percentiles are read off the cumulative counts.
+ */
+class latency_histogram
+{
+public:
+    explicit latency_histogram(int precision = 7) :
+        m_precision(precision), m_sub_buckets(std::uint64_t(1) << precision),
+        m_counts((64 - precision + 2) * (m_sub_buckets / 2), 0)
+    {
+    }
+
+    void record(std::uint64_t ns)
+    {
+        m_counts[index(ns)]++;
+        m_count++;
+        m_min = std::min(m_min, ns);
+        m_max = std::max(m_max, ns);
+    }
+
+    template<typename rep_t, typename period_t>
+    void record(std::chrono::duration<rep_t, period_t> time)
+    {
+        record(static_cast<std::uint64_t>(std::max<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count(), 0)));
+    }
+
+    void merge(const latency_histogram &other)
+    {
+        for(std::size_t i=0; i<m_counts.size() && i<other.m_counts.size(); ++i)
+            m_counts[i] += other.m_counts[i];
+
+        m_count += other.m_count;
+        m_min = std::min(m_min, other.m_min);
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    void clear()
+    {
+        std::fill(m_counts.begin(), m_counts.end(), 0);
+        m_count = 0;
+        m_min = std::numeric_limits<std::uint64_t>::max();
+        m_max = 0;
+    }
+
+    std::uint64_t count() const { return m_count; }
+
+    // in seconds, like the averages of the benchmarks
+    double min() const { return m_count != 0 ? m_min * 1.0e-9 : 0.0; }
+    double max() const { return m_max * 1.0e-9; }
+
+    // p in [0, 100], the middle of the bucket holding the p-th percentile
+    double percentile(double p) const
+    {
+        if( m_count == 0 )
+            return 0.0;
+
+        auto rank = static_cast<std::uint64_t>(p / 100.0 * m_count + 0.5);
+        rank = std::min(std::max<std::uint64_t>(rank, 1), m_count);
+
+        std::uint64_t seen = 0;
+
+        for(std::size_t i=0; i<m_counts.size(); ++i)
+        {
+            seen += m_counts[i];
+
+            if( seen >= rank )
+            {
+                auto value = bucket_lower(i) + bucket_width(i) / 2;
+                return std::min(std::max(value, m_min), m_max) * 1.0e-9;
+            }
+        }
+
+        return max();
+    }
+
+    // the usual set of a latency report
+    struct summary_t
+    {
+        double min, p50, p90, p99, p999, max;
+    };
+
+    summary_t summary() const
+    {
+        return { min(), percentile(50.0), percentile(90.0), percentile(99.0), percentile(99.9), max() };
+    }
+
+private:
+    static int msb(std::uint64_t v)
+    {
+        return 63 - __builtin_clzll(v);
+    }
+
+    std::size_t index(std::uint64_t v) const
+    {
+        if( v < m_sub_buckets )
+            return v;
+
+        const int shift = msb(v) - m_precision + 1;
+        return shift * (m_sub_buckets / 2) + (v >> shift);
+    }
+
+    std::uint64_t bucket_lower(std::size_t i) const
+    {
+        if( i < m_sub_buckets )
+            return i;
+
+        const int shift = i / (m_sub_buckets / 2) - 1;
+        return (i - shift * (m_sub_buckets / 2)) << shift;
+    }
+
+    std::uint64_t bucket_width(std::size_t i) const
+    {
+        return i < m_sub_buckets ? 1 : std::uint64_t(1) << (i / (m_sub_buckets / 2) - 1);
+    }
+
+    int m_precision;
+    std::uint64_t m_sub_buckets;
+    std::vector<std::uint64_t> m_counts;
+
+    std::uint64_t m_count{ 0 };
+    std::uint64_t m_min{ std::numeric_limits<std::uint64_t>::max() };
+    std::uint64_t m_max{ 0 };
+};
+
+#endif
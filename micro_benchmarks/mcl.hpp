@@ -117,72 +117,6 @@ namespace mc
         std::cout << name_str << stringify_container(c) << std::endl;
     }
     
-    inline void export_containers(std::string filename, std::vector<std::string> headers) 
-    {
-        if( headers.size() != 0 )
-            throw std::runtime_error("number of headers must match number of containers");
-    }
-        
-    template<class container_t, class ... containers_t>
-    inline void export_containers(std::string filename, std::vector<std::string> headers, 
-                                  const container_t &container, const containers_t& ... remaining)
-    {
-        std::ifstream old_file(filename, std::ios::in);
-        std::stringstream file_buffer;
-        
-        // file is empty
-        if(old_file.peek() == std::ifstream::traits_type::eof() )
-        {
-            // write first header and erase afterwards
-            file_buffer << headers.front() << '\n';
-            headers.erase(headers.begin());
-            
-            // write data of first container
-            for(auto &el : container)
-            {
-                file_buffer << el << '\n';
-            }
-        }
-        else
-        {
-            bool has_header = false;
-            auto it = container.begin();
-            
-            for(char next = old_file.get(); !old_file.eof(); old_file.get(next))
-            {
-                if( next == '\n' )
-                {
-                    if( !has_header )
-                    {
-                        if( !headers.empty() )
-                            file_buffer << '\t' << headers.front();
-                        else
-                            throw std::runtime_error("number of headers must match number of containers");
-                        
-                        headers.erase(headers.begin());
-                        has_header = true;
-                    }
-                    else
-                    {
-                        if( it != container.end() )
-                            file_buffer << '\t' << *it++;
-                        else
-                            throw std::runtime_error("vector sizes do not match!");
-                    }
-                }
-                file_buffer << next;
-            }
-        }
-        
-        old_file.close();
-        
-        std::ofstream new_file(filename, std::ios::out  | std::ios::trunc);
-        new_file << file_buffer.str();
-        new_file.close();
-        
-        export_containers(filename, headers, remaining...);
-    }
-    
     inline void clear_file(std::string filename)
     {
         std::ofstream file(filename, std::ios::out | std::ios::trunc);
@@ -0,0 +1,197 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstddef>
+
+#include "pairs.hpp"
+
+/*
+ * command line options of the ping-pong benchmarks, given as --name=value (flags without value):
+ *
+ *   --tests=a,b,...     tests to run, the benchmark defines which exist
+ *   --min-size=B        smallest message size
+ *   --max-size=B        largest message size, 0 for the largest the test supports
+ *   --step=F | +B       multiply the size by F or add B bytes per step
+ *   --round-trips=N     round trips (messages of the streaming tests) per measurement
+ *   --warmup=N          round trips before every measurement
+ *   --iterations=N      measurements per message size
+ *   --windows=W,W,...   operations in flight in the streaming tests
+ *   --reply, --no-reply answer every message with a reply AM
+ *   --segment=B         GASNet segment size
+ *   --pairs=MODE        how the ranks pair up: adjacent, intra, inter or random (see pairs.hpp)
+ *   --seed=N            seed of the random pairing
+ *   --output=PREFIX     prepended to the names of the result files
+ */
+struct pingpong_options_t
+{
+    std::vector<std::string> tests;
+    std::size_t min_size = 8;
+    std::size_t max_size = 0;
+    std::size_t step = 2;
+    bool step_add = false;
+    int round_trips = 500;
+    int warmup = 0;
+    int iterations = 200;
+    std::vector<int> windows = { 1, 2, 4, 8, 16, 32, 64 };
+    bool reply = false;
+    std::size_t segment_size = 1024*1024;
+    std::string pairing = "adjacent";
+    unsigned seed = 1;
+    std::string output;
+    bool help = false;
+
+    bool has_test(const std::string &name) const
+    {
+        return std::find(tests.begin(), tests.end(), name) != tests.end();
+    }
+
+    std::size_t next_size(std::size_t size) const
+    {
+        return step_add ? size + step : size * step;
+    }
+
+    // message sizes of a test which supports at most limit bytes
+    std::vector<std::size_t> sizes(std::size_t limit) const
+    {
+        const auto last = max_size != 0 ? std::min(max_size, limit) : limit;
+        std::vector<std::size_t> result;
+
+        for(auto size = min_size; size <= last; size = next_size(size))
+            result.push_back(size);
+
+        return result;
+    }
+
+    // tag for file names and headlines, e.g. "_reply_warmup"
+    std::string modifiers() const
+    {
+        return std::string(reply ? "_reply" : "") + (warmup > 0 ? "_warmup" : "");
+    }
+};
+
+inline void print_usage(const char *program, const pingpong_options_t &defaults, const std::vector<std::string> &all_tests)
+{
+    std::cout << "usage: " << program << " [options]" << std::endl;
+    std::cout << "  --tests=LIST       comma separated subset of:";
+    for(auto &t : all_tests) std::cout << " " << t;
+    std::cout << std::endl;
+    std::cout << "  --min-size=B       (" << defaults.min_size << ")" << std::endl;
+    std::cout << "  --max-size=B       (" << defaults.max_size << ", 0: largest supported)" << std::endl;
+    std::cout << "  --step=F | +B      (" << (defaults.step_add ? "+" : "") << defaults.step << ")" << std::endl;
+    std::cout << "  --round-trips=N    (" << defaults.round_trips << ")" << std::endl;
+    std::cout << "  --warmup=N         (" << defaults.warmup << ")" << std::endl;
+    std::cout << "  --iterations=N     (" << defaults.iterations << ")" << std::endl;
+    std::cout << "  --windows=LIST     (";
+    for(std::size_t i=0; i<defaults.windows.size(); ++i) std::cout << (i ? "," : "") << defaults.windows[i];
+    std::cout << ")" << std::endl;
+    std::cout << "  --reply, --no-reply" << std::endl;
+    std::cout << "  --segment=B        (" << defaults.segment_size << ")" << std::endl;
+    std::cout << "  --pairs=MODE       (" << defaults.pairing << ", one of:";
+    for(auto &m : pairing_modes()) std::cout << " " << m;
+    std::cout << ")" << std::endl;
+    std::cout << "  --seed=N           (" << defaults.seed << ", random pairing)" << std::endl;
+    std::cout << "  --output=PREFIX    prepended to the result files" << std::endl;
+}
+
+// throws std::runtime_error on unknown options or values
+inline pingpong_options_t parse_options(int argc, char **argv, pingpong_options_t options, const std::vector<std::string> &all_tests)
+{
+    auto number = [](const std::string &name, const std::string &value)
+    {
+        std::size_t pos = 0;
+        long long n = -1;
+
+        try { n = std::stoll(value, &pos); } catch(std::exception &) {}
+
+        if( n < 0 || pos != value.size() )
+            throw std::runtime_error("option --" + name + " needs a non-negative number, got '" + value + "'");
+
+        return static_cast<std::size_t>(n);
+    };
+
+    if( options.tests.empty() )
+        options.tests = all_tests;
+
+    for(int i=1; i<argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if( arg.compare(0, 2, "--") != 0 )
+            throw std::runtime_error("unexpected argument '" + arg + "', see --help");
+
+        auto eq = arg.find('=');
+        auto name = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+        auto value = eq == std::string::npos ? std::string() : arg.substr(eq + 1);
+
+        if( name == "help" )              options.help = true;
+        else if( name == "reply" )        options.reply = true;
+        else if( name == "no-reply" )     options.reply = false;
+        else if( name == "min-size" )     options.min_size = number(name, value);
+        else if( name == "max-size" )     options.max_size = number(name, value);
+        else if( name == "round-trips" )  options.round_trips = number(name, value);
+        else if( name == "warmup" )       options.warmup = number(name, value);
+        else if( name == "iterations" )   options.iterations = number(name, value);
+        else if( name == "segment" )      options.segment_size = number(name, value);
+        else if( name == "output" )       options.output = value;
+        else if( name == "seed" )         options.seed = number(name, value);
+        else if( name == "pairs" )
+        {
+            if( std::find(pairing_modes().begin(), pairing_modes().end(), value) == pairing_modes().end() )
+                throw std::runtime_error("unknown pairing '" + value + "', see --help");
+
+            options.pairing = value;
+        }
+        else if( name == "step" )
+        {
+            options.step_add = !value.empty() && value[0] == '+';
+            options.step = number(name, options.step_add ? value.substr(1) : value);
+        }
+        else if( name == "windows" )
+        {
+            options.windows.clear();
+            std::stringstream list(value);
+
+            for(std::string w; std::getline(list, w, ','); )
+                options.windows.push_back(number(name, w));
+        }
+        else if( name == "tests" )
+        {
+            options.tests.clear();
+            std::stringstream list(value);
+
+            for(std::string t; std::getline(list, t, ','); )
+            {
+                if( std::find(all_tests.begin(), all_tests.end(), t) == all_tests.end() )
+                    throw std::runtime_error("unknown test '" + t + "', see --help");
+
+                options.tests.push_back(t);
+            }
+        }
+        else
+        {
+            throw std::runtime_error("unknown option '" + arg + "', see --help");
+        }
+    }
+
+    if( options.min_size == 0 || (options.step_add ? options.step == 0 : options.step < 2) )
+        throw std::runtime_error("sizes must start above 0 and grow with every step");
+
+    if( options.max_size != 0 && options.min_size > options.max_size )
+        throw std::runtime_error("empty size range, --min-size is above --max-size");
+
+    if( options.round_trips == 0 || options.iterations == 0 )
+        throw std::runtime_error("round trips and iterations must be at least 1");
+
+    if( options.windows.empty() || std::find(options.windows.begin(), options.windows.end(), 0) != options.windows.end() )
+        throw std::runtime_error("windows must be at least 1");
+
+    return options;
+}
+
+#endif
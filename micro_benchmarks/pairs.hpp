@@ -0,0 +1,124 @@
+#ifndef PAIRS_HPP
+#define PAIRS_HPP
+
+#include <vector>
+#include <string>
+#include <map>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+/*
+ * splits the ranks into pairs that run the ping-pong at the same time:
+ *
+ *   adjacent   0-1, 2-3, ...
+ *   intra      partners on the same host
+ *   inter      partners on different hosts
+ *   random     shuffled with a fixed seed, so every rank computes the same pairs
+ *
+ * ranks without a partner only take part in the barriers.
+ */
+struct pairing_t
+{
+    std::vector<int> partner;   // -1 for ranks without a partner
+
+    int peer(int rank) const { return partner[rank]; }
+
+    // the lower rank of a pair drives the ping-pong and takes the times
+    bool first(int rank) const { return partner[rank] > rank; }
+
+    // lower ranks of all pairs, the index of a pair is its position here
+    std::vector<int> firsts() const
+    {
+        std::vector<int> result;
+
+        for(std::size_t r=0; r<partner.size(); ++r)
+            if( first(r) ) result.push_back(r);
+
+        return result;
+    }
+
+    // the rank printing the results: the one driving the first pair
+    int reporter() const { return firsts().front(); }
+};
+
+inline const std::vector<std::string> &pairing_modes()
+{
+    static const std::vector<std::string> modes = { "adjacent", "intra", "inter", "random" };
+    return modes;
+}
+
+// host_of[r] identifies the host of rank r, e.g. gasnet_nodeinfo_t::host
+inline pairing_t make_pairing(const std::vector<int> &host_of, const std::string &mode, unsigned seed)
+{
+    const int n = host_of.size();
+
+    pairing_t result;
+    result.partner.assign(n, -1);
+
+    auto pair_up = [&](int a, int b)
+    {
+        result.partner[a] = b;
+        result.partner[b] = a;
+    };
+
+    // ranks of every host, lowest rank last so that pop_back() takes it
+    std::vector<std::vector<int>> hosts;
+    {
+        std::map<int, std::vector<int>> by_host;
+
+        for(int r=n-1; r>=0; --r)
+            by_host[host_of[r]].push_back(r);
+
+        for(auto &h : by_host)
+            hosts.push_back(h.second);
+    }
+
+    if( mode == "adjacent" )
+    {
+        for(int r=0; r+1<n; r+=2)
+            pair_up(r, r+1);
+    }
+    else if( mode == "random" )
+    {
+        std::vector<int> order(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+
+        for(int i=0; i+1<n; i+=2)
+            pair_up(order[i], order[i+1]);
+    }
+    else if( mode == "intra" )
+    {
+        for(auto &ranks : hosts)
+            for(std::size_t i=0; i+1<ranks.size(); i+=2)
+                pair_up(ranks[ranks.size()-1-i], ranks[ranks.size()-2-i]);
+    }
+    else if( mode == "inter" )
+    {
+        // always pair the two hosts with the most ranks left, that leaves the fewest ranks out
+        while( true )
+        {
+            std::stable_sort(hosts.begin(), hosts.end(), [](const std::vector<int> &a, const std::vector<int> &b){ return a.size() > b.size(); });
+
+            if( hosts.size() < 2 || hosts[1].empty() )
+                break;
+
+            pair_up(hosts[0].back(), hosts[1].back());
+            hosts[0].pop_back();
+            hosts[1].pop_back();
+        }
+    }
+    else
+    {
+        throw std::runtime_error("unknown pairing '" + mode + "'");
+    }
+
+    if( std::find_if(result.partner.begin(), result.partner.end(), [](int p){ return p >= 0; }) == result.partner.end() )
+        throw std::runtime_error("pairing '" + mode + "' leaves no pair, need at least 2 processes (on the same or on different hosts)");
+
+    return result;
+}
+
+#endif
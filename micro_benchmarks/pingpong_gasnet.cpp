@@ -8,15 +8,15 @@
 
 #include "mcl.hpp"
 #include "result.hpp"
+#include "options.hpp"
+#include "pairs.hpp"
+#include "collect.hpp"
+#include "timer.hpp"
 
 #include "test_short.hpp"
 #include "test_medium.hpp"
 #include "test_long.hpp"
-
-// #define DO_REPLY
-// #define DO_WARMUP
-
-constexpr int iterations = 200;
+#include "test_putget.hpp"
 
 int main(int argc, char ** argv)    
 {
@@ -26,134 +26,362 @@ int main(int argc, char ** argv)
         { medium_req_id, (void(*)())medium_request_handler },
         { medium_rep_id, (void(*)())medium_reply_handler },
         { long_req_id,   (void(*)())long_request_handler },
-        { long_rep_id,   (void(*)())long_reply_handler }
+        { long_rep_id,   (void(*)())long_reply_handler },
+        { collect_id,    (void(*)())collect_handler }
     };
     
-    std::size_t segment_size = 1024*1024; // 1 MB
-    if(argc == 2) segment_size = std::atoi(argv[1]);
+    const std::vector<std::string> all_tests = { "short", "medium", "long", "put", "put_nb", "put_nbi", "get", "get_nb", "get_nbi" };
     
     gasnet_init(&argc, &argv);
-    gasnet_attach(handlers.data(), handlers.size(), segment_size, 0);
+    
+    pingpong_options_t defaults;
+    pingpong_options_t opt;
+    
+    try { opt = parse_options(argc, argv, defaults, all_tests); }
+    catch(std::runtime_error &e)
+    {
+        if( gasnet_mynode() == 0 ) { std::cerr << e.what() << std::endl; print_usage(argv[0], defaults, all_tests); }
+        gasnet_exit(1);
+    }
+    
+    if( opt.help )
+    {
+        if( gasnet_mynode() == 0 ) print_usage(argv[0], defaults, all_tests);
+        gasnet_exit(0);
+    }
+    
+    gasnet_attach(handlers.data(), handlers.size(), opt.segment_size, 0);
     
     int rank = gasnet_mynode();
-    std::string filename_modifiers;
+    std::string filename_modifiers = opt.modifiers();
+    
+    // all pairs run at the same time, the first rank of the first pair reports
+    std::vector<gasnet_nodeinfo_t> nodeinfo(gasnet_nodes());
+    gasnet_getNodeInfo(nodeinfo.data(), nodeinfo.size());
+    
+    std::vector<int> host_of;
+    for(auto &info : nodeinfo) host_of.push_back(info.host);
     
-    if( gasnet_nodes() != 2 ) throw std::runtime_error("Must run with 2 processes!");
+    // a mode that leaves no pair, e.g. --pairs=inter on a single host, is an option error
+    pairing_t pairing;
     
-    if(rank == 0 ) 
+    try { pairing = make_pairing(host_of, opt.pairing, opt.seed); }
+    catch(std::runtime_error &e)
+    {
+        if( rank == 0 ) { std::cerr << e.what() << std::endl; print_usage(argv[0], defaults, all_tests); }
+        gasnet_exit(1);
+    }
+    
+    const auto pairs = pairing.firsts().size();
+    const int reporter = pairing.reporter();
+    const int peer = pairing.peer(rank);
+    const bool first = pairing.first(rank);
+
+    const auto metadata = gasnet_metadata("gasnet_pingpong", opt, {"reply", "segment_size", "pairing", "seed"}, reporter);
+    
+    if( rank == reporter ) 
     {
         std::cout << "PING-PONG BENCHMARK";
-#ifdef DO_REPLY
-        std::cout << " \\w reply";
-        filename_modifiers += "_reply";
-#else
-        std::cout << " \\wo reply";
-#endif
-        
-#ifdef DO_WARMUP
-        std::cout << " \\w warmup";
-        filename_modifiers += "_warmup";
-#else
-        std::cout << " \\wo warmup";
-#endif
+        std::cout << (opt.reply ? " \\w reply" : " \\wo reply");
+        std::cout << (opt.warmup > 0 ? " \\w warmup" : " \\wo warmup");
         std::cout << std::endl;
+        std::cout << "- round trips: " << opt.round_trips << ", warmup: " << opt.warmup << ", iterations: " << opt.iterations << std::endl;
+        std::cout << "- timer: " << timer_description() << std::endl;
+        
+        if( pairs > 1 )
+            std::cout << "- pairs: " << pairs << " (" << opt.pairing << "), the single pair results are those of pair 0" << std::endl;
     }
     
     // test short messages
-    if(rank == 0 ) std::cout << "- ping-pong on short" << std::endl;
-    
     std::vector<double> data_short;
-    for(std::size_t i=0; i<iterations; ++i)
-        data_short.push_back(benchmark_short());
+    percentile_data_t short_percentiles;
+    
+    if( opt.has_test("short") )
+    {
+        if(rank == reporter ) std::cout << "- ping-pong on short" << std::endl;
+        
+        latency_histogram latencies;
+        
+        for(int i=0; i<opt.iterations; ++i)
+            data_short.push_back(benchmark_short(peer, first, opt, latencies));
+        
+        short_percentiles.add(0, latencies);
+    }
 
     // test medium messages
-    int medium_msg_size_min = 8;
-    int medium_msg_size_max = std::min(segment_size, gasnet_AMMaxMedium());
-    if(rank == 0 ) std::cout << "- ping-pong on medium, sizes: [ " << medium_msg_size_min << " B, " << medium_msg_size_max/1.0e3 << " kB ]" << std::endl;
-    
     std::vector<int> medium_sizes;
     std::vector<double> medium_times;
     std::vector<double> medium_times_err;
+    percentile_data_t medium_percentiles;
     
-    for(std::size_t msg_size = medium_msg_size_min; msg_size < medium_msg_size_max; msg_size *= 2)
+    if( opt.has_test("medium") )
     {
-        std::vector<double> times;
+        auto sizes = opt.sizes(std::min(opt.segment_size, gasnet_AMMaxMedium()));
         
-        for(std::size_t i=0; i<iterations; ++i)
-            times.push_back( benchmark_medium(msg_size) );
+        if(rank == reporter && !sizes.empty()) 
+            std::cout << "- ping-pong on medium, sizes: [ " << sizes.front() << " B, " << sizes.back()/1.0e3 << " kB ]" << std::endl;
         
-        medium_sizes.push_back(msg_size);
-        medium_times.push_back(mc::average(times));
-        medium_times_err.push_back(mc::standard_deviation(times));
+        for(auto msg_size : sizes)
+        {
+            std::vector<double> times;
+            latency_histogram latencies;
+            
+            for(int i=0; i<opt.iterations; ++i)
+                times.push_back( benchmark_medium(msg_size, peer, first, opt, latencies) );
+            
+            medium_percentiles.add(msg_size, latencies);
+            
+            medium_sizes.push_back(msg_size);
+            medium_times.push_back(mc::average(times));
+            medium_times_err.push_back(mc::standard_deviation(times));
+        }
     }
     
     // test long messages
-    int long_msg_size_min = 8;
-    int long_msg_size_max = std::min(segment_size, gasnet_AMMaxLongRequest());
-    if(rank == 0 ) std::cout << "- ping-pong on long, sizes: [ " << long_msg_size_min << " B, " << long_msg_size_max/1.0e6 << " MB ]" << std::endl;
-    
     std::vector<int> long_sizes;
     std::vector<double> long_times;
     std::vector<double> long_times_err;
+    percentile_data_t long_percentiles;
     
-    for(std::size_t msg_size = long_msg_size_min; msg_size < long_msg_size_max; msg_size *= 2)
+    if( opt.has_test("long") )
     {
+        auto sizes = opt.sizes(std::min(opt.segment_size, gasnet_AMMaxLongRequest()));
+        
+        if(rank == reporter && !sizes.empty()) 
+            std::cout << "- ping-pong on long, sizes: [ " << sizes.front() << " B, " << sizes.back()/1.0e6 << " MB ]" << std::endl;
+        
+        for(auto msg_size : sizes)
+        {
+            std::vector<double> times;
+            latency_histogram latencies;
+            
+            for(int i=0; i<opt.iterations; ++i)
+                times.push_back( benchmark_long(msg_size, peer, first, opt, latencies) );
+            
+            long_percentiles.add(msg_size, latencies);
+            
+            long_sizes.push_back(msg_size);
+            long_times.push_back(mc::average(times));
+            long_times_err.push_back(mc::standard_deviation(times));
+        }
+    }
+    
+    // test one-sided puts and gets, with the local buffer in the segment and on the heap
+    struct onesided_test_t
+    {
+        std::string name;
+        onesided_op_t op;
+        onesided_sync_t sync;
+    };
+    
+    const std::vector<onesided_test_t> onesided_tests = {
+        { "put",     onesided_op_t::put, onesided_sync_t::blocking },
+        { "put_nb",  onesided_op_t::put, onesided_sync_t::nb },
+        { "put_nbi", onesided_op_t::put, onesided_sync_t::nbi },
+        { "get",     onesided_op_t::get, onesided_sync_t::blocking },
+        { "get_nb",  onesided_op_t::get, onesided_sync_t::nb },
+        { "get_nbi", onesided_op_t::get, onesided_sync_t::nbi }
+    };
+    
+    struct onesided_data_t
+    {
+        std::string name;
+        bool blocking;
+        std::vector<int> sizes;
         std::vector<double> times;
+        std::vector<double> times_err;
+        percentile_data_t percentiles;
+        pair_data_t pairs;
+    };
+    
+    std::vector<onesided_data_t> onesided_data;
+    
+    for(auto &test : onesided_tests)
+    {
+        if( !opt.has_test(test.name) )
+            continue;
         
-        for(std::size_t i=0; i<iterations; ++i)
-            times.push_back( benchmark_long(msg_size) );
+        for(bool in_segment : { true, false })
+        {
+            onesided_data_t data;
+            data.name = test.name + (in_segment ? "_seg" : "_heap");
+            data.blocking = ( test.sync == onesided_sync_t::blocking );
+            
+            auto sizes = opt.sizes(opt.segment_size);
+            
+            if(rank == reporter && !sizes.empty()) 
+                std::cout << "- one-sided " << data.name << ", sizes: [ " << sizes.front() << " B, " << sizes.back()/1.0e6 << " MB ]" << std::endl;
+            
+            for(auto msg_size : sizes)
+            {
+                std::vector<double> times;
+                latency_histogram latencies;
+                
+                for(int i=0; i<opt.iterations; ++i)
+                    times.push_back( benchmark_onesided(test.op, test.sync, in_segment, msg_size, peer, first, opt, latencies) );
+                
+                if( data.blocking )
+                    data.percentiles.add(msg_size, latencies);
+                
+                data.sizes.push_back(msg_size);
+                data.times.push_back(mc::average(times));
+                data.times_err.push_back(mc::standard_deviation(times));
+            }
+            
+            onesided_data.push_back(data);
+        }
+    }
+    
+    // collect the times of all pairs
+    auto collect_pairs = [&](const std::vector<double> &times, const std::vector<int> &sizes)
+    {
+        auto times_of_rank = gather_results(times, reporter);
+        return rank == reporter ? compute_pair_data(pairing, times_of_rank, sizes) : pair_data_t();
+    };
+    
+    pair_data_t short_pairs, medium_pairs, long_pairs;
+    
+    if( pairs > 1 )
+    {
+        if( !data_short.empty() )   short_pairs  = collect_pairs({ mc::average(data_short) }, { 0 });
+        if( !medium_sizes.empty() ) medium_pairs = collect_pairs(medium_times, medium_sizes);
+        if( !long_sizes.empty() )   long_pairs   = collect_pairs(long_times, long_sizes);
         
-        long_sizes.push_back(msg_size);
-        long_times.push_back(mc::average(times));
-        long_times_err.push_back(mc::standard_deviation(times));
+        for(auto &data : onesided_data)
+            if( !data.sizes.empty() ) data.pairs = collect_pairs(data.times, data.sizes);
     }
     
+    const std::string pairs_modifiers = "_pairs_" + opt.pairing + filename_modifiers;
+    
     BARRIER();
     // compute results    
-    if( rank == 0 )
+    if( rank == reporter )
     {
         std::cout << std::fixed;
         std::cout << "RESULTS:" << std::endl; 
         
         // short
-        std::cout << "- short:  min_time         = ( " 
-                  << mc::average(data_short)*1.0e6 << " +- " << mc::standard_deviation(data_short)*1.0e6 << " ) us    => latency" << std::endl;
+        if( !data_short.empty() )
+        {
+            std::cout << "- short:  min_time         = ( " 
+                      << mc::average(data_short)*1.0e6 << " +- " << mc::standard_deviation(data_short)*1.0e6 << " ) us    => latency" << std::endl;
+            
+            print_percentiles("short:  ", short_percentiles);
+            export_percentiles(opt.output + "gasnet_pingpong_short_latency" + filename_modifiers, metadata, short_percentiles);
+            
+            if( pairs > 1 )
+            {
+                print_pairs("short:  ", short_pairs);
+                export_pairs(opt.output + "gasnet_pingpong_short" + pairs_modifiers, metadata, short_pairs);
+            }
+        }
         
         // medium
-        auto mtimes = compute_time_data(medium_times, medium_times_err, medium_sizes);
-        auto mlatency = mtimes.min_avg;
+        if( !medium_sizes.empty() )
+        {
+            auto mtimes = compute_time_data(medium_times, medium_times_err, medium_sizes);
+            auto mlatency = mtimes.min_avg;
         
-        std::cout << "- medium: min_time         = ( " << mtimes.min_avg*1.0e6 << " +- " << mtimes.min_err*1.0e6 << " ) us    => latency" << std::endl;
-        std::cout << "- medium: size @min_time   = " << mtimes.min_size << " B" << std::endl;
+            std::cout << "- medium: min_time         = ( " << mtimes.min_avg*1.0e6 << " +- " << mtimes.min_err*1.0e6 << " ) us    => latency" << std::endl;
+            std::cout << "- medium: size @min_time   = " << mtimes.min_size << " B" << std::endl;
         
-        std::cout << "- medium: max_time         = ( " << mtimes.max_avg*1.0e6 << " +- " << mtimes.max_err*1.0e6 << " ) us" << std::endl;
-        std::cout << "- medium: size @max_time   = " << mtimes.max_size << " B" << std::endl;
+            std::cout << "- medium: max_time         = ( " << mtimes.max_avg*1.0e6 << " +- " << mtimes.max_err*1.0e6 << " ) us" << std::endl;
+            std::cout << "- medium: size @max_time   = " << mtimes.max_size << " B" << std::endl;
         
-        auto mbndws = compute_bandwidth_data(mlatency, medium_times, medium_sizes);
+            auto mbndws = compute_bandwidth_data(mlatency, medium_times, medium_sizes);
         
-        std::cout << "- medium: bandwidth range  = [ " << mbndws.min/1.0e9 << ", " << mbndws.max/1.0e9 << " ] GB/s" << std::endl;
-        std::cout << "- medium: bandwidth value  = ( " << mbndws.avg/1.0e9 << " +- " << mbndws.err/1.0e9 << " ) GB/s" << std::endl;
+            std::cout << "- medium: bandwidth range  = [ " << mbndws.min/1.0e9 << ", " << mbndws.max/1.0e9 << " ] GB/s" << std::endl;
+            std::cout << "- medium: bandwidth value  = ( " << mbndws.avg/1.0e9 << " +- " << mbndws.err/1.0e9 << " ) GB/s" << std::endl;
+        
+            write_results(opt.output + "gasnet_pingpong_medium" + filename_modifiers, metadata, {"size", "time", "error"}, medium_sizes, medium_times, medium_times_err);
+            
+            print_percentiles("medium: ", medium_percentiles);
+            export_percentiles(opt.output + "gasnet_pingpong_medium_latency" + filename_modifiers, metadata, medium_percentiles);
+            
+            if( pairs > 1 )
+            {
+                print_pairs("medium: ", medium_pairs);
+                export_pairs(opt.output + "gasnet_pingpong_medium" + pairs_modifiers, metadata, medium_pairs);
+            }
+        }
         
-        mc::clear_file("gasnet_pingpong_medium" + filename_modifiers + ".txt");
-        mc::export_containers("gasnet_pingpong_medium" + filename_modifiers + ".txt", {"size", "time", "error"}, medium_sizes, medium_times, medium_times_err);
-                
         // long
-        auto ltimes = compute_time_data(long_times, long_times_err, long_sizes);
-        auto llatency = ltimes.min_avg;
+        if( !long_sizes.empty() )
+        {
+            auto ltimes = compute_time_data(long_times, long_times_err, long_sizes);
+            auto llatency = ltimes.min_avg;
+        
+            std::cout << "- long:   min_time         = ( " << ltimes.min_avg*1.0e6 << " +- " << ltimes.min_err*1.0e6 << " ) us    => latency" << std::endl;
+            std::cout << "- long:   size @min_time   = " << ltimes.min_size << " B" << std::endl;
+        
+            std::cout << "- long:   max_time         = ( " << ltimes.max_avg*1.0e6 << " +- " << ltimes.max_err*1.0e6 << " ) us" << std::endl;
+            std::cout << "- long:   size @max_time   = " << ltimes.max_size << " B" << std::endl;
+        
+            auto lbndws = compute_bandwidth_data(llatency, long_times, long_sizes);
+        
+            std::cout << "- long:   bandwidth range  = [ " << lbndws.min/1.0e9 << ", " << lbndws.max/1.0e9 << " ] GB/s" << std::endl;
+            std::cout << "- long:   bandwidth value  = ( " << lbndws.avg/1.0e9 << " +- " << lbndws.err/1.0e9 << " ) GB/s" << std::endl;
+        
+            write_results(opt.output + "gasnet_pingpong_long" + filename_modifiers, metadata, {"size", "time", "error"}, long_sizes, long_times, long_times_err);
+            
+            print_percentiles("long:   ", long_percentiles);
+            export_percentiles(opt.output + "gasnet_pingpong_long_latency" + filename_modifiers, metadata, long_percentiles);
+            
+            if( pairs > 1 )
+            {
+                print_pairs("long:   ", long_pairs);
+                export_pairs(opt.output + "gasnet_pingpong_long" + pairs_modifiers, metadata, long_pairs);
+            }
+        }
+        
+        // one-sided, times per operation: completion of a blocking one, throughput of pipelined nb and nbi ones
+        for(auto &data : onesided_data)
+        {
+            if( data.sizes.empty() )
+                continue;
+            
+            const auto label = data.name + ": ";
+            
+            print_time_data(label, data.times, data.times_err, data.sizes);
+            
+            write_results(opt.output + "gasnet_pingpong_" + data.name + filename_modifiers, metadata, {"size", "time", "error"}, data.sizes, data.times, data.times_err);
+            
+            if( data.blocking )
+            {
+                print_percentiles(label, data.percentiles);
+                export_percentiles(opt.output + "gasnet_pingpong_" + data.name + "_latency" + filename_modifiers, metadata, data.percentiles);
+            }
+            
+            if( pairs > 1 )
+            {
+                print_pairs(label, data.pairs);
+                export_pairs(opt.output + "gasnet_pingpong_" + data.name + pairs_modifiers, metadata, data.pairs);
+            }
+        }
         
-        std::cout << "- long:   min_time         = ( " << ltimes.min_avg*1.0e6 << " +- " << ltimes.min_err*1.0e6 << " ) us    => latency" << std::endl;
-        std::cout << "- long:   size @min_time   = " << ltimes.min_size << " B" << std::endl;
+        // which primitive wins at which size: latencies of AMs and blocking put/get, per-op times of pipelined nb/nbi apart
+        std::vector<std::string> labels, pipelined_labels;
+        std::vector<std::vector<int>> sizes, pipelined_sizes;
+        std::vector<std::vector<double>> times, pipelined_times;
         
-        std::cout << "- long:   max_time         = ( " << ltimes.max_avg*1.0e6 << " +- " << ltimes.max_err*1.0e6 << " ) us" << std::endl;
-        std::cout << "- long:   size @max_time   = " << ltimes.max_size << " B" << std::endl;
+        if( !medium_sizes.empty() ) { labels.push_back("medium"); sizes.push_back(medium_sizes); times.push_back(medium_times); }
+        if( !long_sizes.empty() )   { labels.push_back("long");   sizes.push_back(long_sizes);   times.push_back(long_times); }
         
-        auto lbndws = compute_bandwidth_data(llatency, long_times, long_sizes);
+        for(auto &data : onesided_data)
+        {
+            if( data.sizes.empty() )
+                continue;
+            
+            (data.blocking ? labels : pipelined_labels).push_back(data.name);
+            (data.blocking ? sizes : pipelined_sizes).push_back(data.sizes);
+            (data.blocking ? times : pipelined_times).push_back(data.times);
+        }
         
-        std::cout << "- long:   bandwidth range  = [ " << lbndws.min/1.0e9 << ", " << lbndws.max/1.0e9 << " ] GB/s" << std::endl;
-        std::cout << "- long:   bandwidth value  = ( " << lbndws.avg/1.0e9 << " +- " << lbndws.err/1.0e9 << " ) GB/s" << std::endl;
+        if( labels.size() > 1 )
+            print_fastest("lowest latency per size", labels, sizes, times);
         
-        mc::clear_file("gasnet_pingpong_long" + filename_modifiers + ".txt");
-        mc::export_containers("gasnet_pingpong_long" + filename_modifiers + ".txt", {"size", "time", "error"}, long_sizes, long_times, long_times_err);
+        if( pipelined_labels.size() > 1 )
+            print_fastest("highest throughput per size (pipelined nb/nbi, time per operation)", pipelined_labels, pipelined_sizes, pipelined_times);
     }
     
     BARRIER();
@@ -5,33 +5,32 @@
 #include <string>
 #include <cmath>
 #include <cstring>
+#include <chrono>
 
 #include <mpi.h>
 #include "mcl.hpp"
 #include "result.hpp"
+#include "options.hpp"
+#include "histogram.hpp"
+#include "pairs.hpp"
+#include "collect_mpi.hpp"
+#include "timer.hpp"
 
 #define STANDARD_TAG 10
-#define DO_WARMUP
-// #define NON_BLOCKING
-
-const int N = 500;
-const int N_warmup = 50;
-const int iterations = 200;
 
 typedef char byte_t;
 
 double my_time()
 {
     MPI_Barrier(MPI_COMM_WORLD);
-    return MPI_Wtime();
+    return timer_seconds();
 }
 
-double benchmark_loop_block(byte_t *data, size_t size, int destination)
+double benchmark_loop_block(byte_t *data, size_t size, int destination, bool first, const pingpong_options_t &opt, latency_histogram &latencies)
 {
-#ifdef DO_WARMUP
-    for(int n=0; n<N_warmup; ++n)
+    for(int n=0; n<opt.warmup && destination >= 0; ++n)
     {
-        if(destination % 2 == 0)
+        if( first )
         {
             MPI_Ssend(data, size, MPI_BYTE, destination, STANDARD_TAG, MPI_COMM_WORLD);
             MPI_Recv(data, size, MPI_BYTE, destination, STANDARD_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
@@ -43,13 +42,14 @@ double benchmark_loop_block(byte_t *data, size_t size, int destination)
             
         }
     }
-#endif
         
     MPI_Barrier(MPI_COMM_WORLD);
     auto t_0 = my_time();
-    for(int n=0; n<N; ++n)
-    {                
-        if(destination % 2 == 0)
+    for(int n=0; n<opt.round_trips && destination >= 0; ++n)
+    {
+        auto t_start = bench_clock::now();
+        
+        if( first )
         {
             MPI_Ssend(data, size, MPI_BYTE, destination, STANDARD_TAG, MPI_COMM_WORLD);
             MPI_Recv(data, size, MPI_BYTE, destination, STANDARD_TAG, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
@@ -60,88 +60,73 @@ double benchmark_loop_block(byte_t *data, size_t size, int destination)
             MPI_Ssend(data, size, MPI_BYTE, destination, STANDARD_TAG, MPI_COMM_WORLD);
             
         }
+        
+        // only meaningful on the rank that sends first, the other one includes its wait
+        latencies.record((bench_clock::now() - t_start) / 2);
     }
+    // the time of this pair only, the other pairs may still be running
+    auto t_1 = timer_seconds();
     MPI_Barrier(MPI_COMM_WORLD);
-    auto t_1 = my_time();
     
-    return (t_1 - t_0) / (2*N);
+    return (t_1 - t_0) / (2*opt.round_trips);
 }
 
-double benchmark_loop_nonblock(byte_t *send_buffer, byte_t *recv_buffer, size_t size, int destination)
+double benchmark_loop_nonblock(byte_t *send_buffer, byte_t *recv_buffer, size_t size, int destination, const pingpong_options_t &opt, latency_histogram &latencies)
 {
     MPI_Request req_array[2];
     MPI_Status  stat_array[2];
     
-#ifdef DO_WARMUP
-    for(int n=0; n<N_warmup; ++n)
+    for(int n=0; n<opt.warmup && destination >= 0; ++n)
     {
         MPI_Isend(send_buffer, size, MPI_BYTE, destination, STANDARD_TAG, MPI_COMM_WORLD, &req_array[0]);
         MPI_Irecv(recv_buffer, size, MPI_BYTE, destination, STANDARD_TAG, MPI_COMM_WORLD, &req_array[1]);
         MPI_Waitall(2, req_array, stat_array);
         std::memcpy(recv_buffer, send_buffer, size);
     }
-#endif
     
     MPI_Barrier(MPI_COMM_WORLD);
     auto t_0 = my_time();
-    for(int n=0; n<N; ++n)
+    for(int n=0; n<opt.round_trips && destination >= 0; ++n)
     {
+        auto t_start = bench_clock::now();
+        
         MPI_Isend(send_buffer, size, MPI_BYTE, destination, STANDARD_TAG, MPI_COMM_WORLD, &req_array[0]);
         MPI_Irecv(recv_buffer, size, MPI_BYTE, destination, STANDARD_TAG, MPI_COMM_WORLD, &req_array[1]);
         MPI_Waitall(2, req_array, stat_array);
         std::memcpy(recv_buffer, send_buffer, size);
+        
+        // both directions overlap here, so the exchange time is the latency
+        latencies.record(bench_clock::now() - t_start);
     }
+    // the time of this pair only, the other pairs may still be running
+    auto t_1 = timer_seconds();
     MPI_Barrier(MPI_COMM_WORLD);
-    auto t_1 = my_time();
 
-    return (t_1 - t_0) / (2*N);    
+    return (t_1 - t_0) / (2*opt.round_trips);    
 }
 
-double benchmark(int rank, size_t message_size)
+// ranks without a partner (destination -1) only take part in the barriers
+double benchmark(int destination, bool first, size_t message_size, bool non_blocking, const pingpong_options_t &opt, latency_histogram &latencies)
 {
     double time = 0.0;
     
-    if( rank == 0 )
+    if( non_blocking )
     {
-        int destination = 1;
-#ifdef NON_BLOCKING
         auto send_buffer = new byte_t[message_size];
         auto recv_buffer = new byte_t[message_size];
         
-        time = benchmark_loop_nonblock(send_buffer, recv_buffer, message_size, destination);
+        time = benchmark_loop_nonblock(send_buffer, recv_buffer, message_size, destination, opt, latencies);
         
         delete[] send_buffer;
         delete[] recv_buffer;
-#else
-        auto message = new byte_t[message_size];
-        
-        time = benchmark_loop_block(message, message_size, destination);
-        
-        delete[] message;
-#endif
     }
-    else if( rank == 1 )
+    else
     {
-        int destination = 0;
-#ifdef NON_BLOCKING
-        auto send_buffer = new byte_t[message_size];
-        auto recv_buffer = new byte_t[message_size];
-        
-        time = benchmark_loop_nonblock(send_buffer, recv_buffer, message_size, destination);
-        
-        delete[] send_buffer;
-        delete[] recv_buffer;
-#else
         auto message = new byte_t[message_size];
         
-        time = benchmark_loop_block(message, message_size, destination);
+        time = benchmark_loop_block(message, message_size, destination, first, opt, latencies);
         
         delete[] message;
-#endif
-    }
-    else
-    {
-        throw std::runtime_error("must be run with 2 processes!");
     }
         
     return time;
@@ -149,76 +134,165 @@ double benchmark(int rank, size_t message_size)
 
 int main(int argc, char ** argv)
 {
-    MPI_Init(nullptr, nullptr);
-    MPI_Status status;
+    MPI_Init(&argc, &argv);
     
-    const int message_size_min = 8;
-    int message_size_max = 1024 * 1024; // ca. 1 MB
+    const std::vector<std::string> all_tests = { "blocking", "nonblocking" };
     
-    if(argc == 2) message_size_max = std::atoi(argv[1]);
+    pingpong_options_t defaults;
+    defaults.tests = { "blocking" };
+    defaults.warmup = 50;
+    defaults.max_size = 1024 * 1024; // ca. 1 MB
     
     int rank, size;
     
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
     
-    std::vector<int> sizes;
-    std::vector<double> times;
-    std::vector<double> times_err;
+    pingpong_options_t opt;
+    
+    try
+    {
+        opt = parse_options(argc, argv, defaults, all_tests);
+    
+        // no size limit of its own here, so --max-size=0 leaves no size at all
+        if( opt.sizes(opt.max_size).empty() )
+            throw std::runtime_error("empty size range, see --help");
+    }
+    catch(std::runtime_error &e)
+    {
+        if( rank == 0 ) { std::cerr << e.what() << std::endl; print_usage(argv[0], defaults, all_tests); }
+        MPI_Finalize();
+        return 1;
+    }
     
-    if(rank == 0 )
+    if( opt.help )
     {
-        std::cout << "PING-PONG BENCHMARK";
-#ifdef DO_WARMUP
-        std::cout << " \\w warmup";
-#else
-        std::cout << " \\wo warmup";
-#endif
-        
-#ifdef NON_BLOCKING
-        std::cout << " \\non blocking";
-#else
-        std::cout << " \\blocking";
-#endif
-        std::cout <<std::endl;
-        std::cout << "- ping-pong sizes: [ " << message_size_min << " B, " << message_size_max/1.0e6 << " MB ]" << std::endl;
+        if( rank == 0 ) print_usage(argv[0], defaults, all_tests);
+        MPI_Finalize();
+        return 0;
     }
     
-    for(size_t message_size = message_size_min; message_size < message_size_max; message_size *= 2)
+    // all pairs run at the same time, the first rank of the first pair reports
+    const auto metadata = mpi_metadata("mpi_pingpong", opt, {"pairing", "seed"});
+    const auto hostnames = gather_hostnames_mpi();
+    
+    std::vector<std::string> hosts;
+    std::vector<int> host_of;
+    
+    for(int r=0; r<size; ++r)
     {
-        std::vector<double> t;
-        
-        for(int i=0; i<iterations; ++i)
-            t.push_back( benchmark(rank, message_size) );
+        auto it = std::find(hosts.begin(), hosts.end(), hostnames[r]);
         
-        sizes.push_back(message_size);
-        times.push_back(mc::average(t));
-        times_err.push_back(mc::standard_deviation(t));
+        host_of.push_back(it - hosts.begin());
+        if( it == hosts.end() ) hosts.push_back(hostnames[r]);
     }
     
-    if( rank == 0 )
+    // a mode that leaves no pair, e.g. --pairs=inter on a single host, is an option error
+    pairing_t pairing;
+    
+    try { pairing = make_pairing(host_of, opt.pairing, opt.seed); }
+    catch(std::runtime_error &e)
+    {
+        if( rank == 0 ) { std::cerr << e.what() << std::endl; print_usage(argv[0], defaults, all_tests); }
+        MPI_Finalize();
+        return 1;
+    }
+    
+    const auto pairs = pairing.firsts().size();
+    const int reporter = pairing.reporter();
+    
+    const auto message_sizes = opt.sizes(opt.max_size);
+    
+    for(auto &test : opt.tests)
     {
-        std::cout << std::fixed;
-        std::cout << "RESULTS:" << std::endl; 
+        const bool non_blocking = ( test == "nonblocking" );
         
-        auto timedat = compute_time_data(times, times_err, sizes);
-        auto latency = timedat.min_avg;
+        std::vector<int> sizes;
+        std::vector<double> times;
+        std::vector<double> times_err;
+        percentile_data_t percentiles;
         
-        std::cout << "- min_time         = ( " << timedat.min_avg*1.0e6 << " +- " << timedat.min_err*1.0e6 << " ) us    => latency" << std::endl;
-        std::cout << "- size @min_time   = " << timedat.min_size << " B" << std::endl;
+        if(rank == reporter )
+        {
+            std::cout << "PING-PONG BENCHMARK";
+            std::cout << (opt.warmup > 0 ? " \\w warmup" : " \\wo warmup");
+            std::cout << (non_blocking ? " \\non blocking" : " \\blocking");
+            std::cout <<std::endl;
+            std::cout << "- ping-pong sizes: [ " << message_sizes.front() << " B, " << message_sizes.back()/1.0e6 << " MB ]" << std::endl;
+            std::cout << "- round trips: " << opt.round_trips << ", warmup: " << opt.warmup << ", iterations: " << opt.iterations << std::endl;
+            std::cout << "- timer: " << timer_description() << std::endl;
+            
+            if( pairs > 1 )
+                std::cout << "- pairs: " << pairs << " (" << opt.pairing << "), the single pair results are those of pair 0" << std::endl;
+        }
         
-        std::cout << "- max_time         = ( " << timedat.max_avg*1.0e6 << " +- " << timedat.max_err*1.0e6 << " ) us" << std::endl;
-        std::cout << "- size @max_time   = " << timedat.max_size << " B" << std::endl;
+        for(auto message_size : message_sizes)
+        {
+            std::vector<double> t;
+            latency_histogram latencies;
+            
+            for(int i=0; i<opt.iterations; ++i)
+                t.push_back( benchmark(pairing.peer(rank), pairing.first(rank), message_size, non_blocking, opt, latencies) );
+            
+            percentiles.add(message_size, latencies);
+            
+            sizes.push_back(message_size);
+            times.push_back(mc::average(t));
+            times_err.push_back(mc::standard_deviation(t));
+        }
         
-        auto mbndws = compute_bandwidth_data(latency, times, sizes);
+        // collect the times of all pairs
+        pair_data_t pair_data;
         
-        std::cout << "- bandwidth range  = [ " << mbndws.min/1.0e9 << ", " << mbndws.max/1.0e9 << " ] GB/s" << std::endl;
-        std::cout << "- bandwidth value  = ( " << mbndws.avg/1.0e9 << " +- " << mbndws.err/1.0e9 << " ) GB/s" << std::endl;
+        if( pairs > 1 )
+        {
+            std::vector<double> all_times(rank == reporter ? size * times.size() : 0);
+            MPI_Gather(times.data(), times.size(), MPI_DOUBLE, all_times.data(), times.size(), MPI_DOUBLE, reporter, MPI_COMM_WORLD);
+            
+            if( rank == reporter )
+            {
+                std::vector<std::vector<double>> times_of_rank;
+                
+                for(int r=0; r<size; ++r)
+                    times_of_rank.emplace_back(all_times.begin() + r*times.size(), all_times.begin() + (r+1)*times.size());
+                
+                pair_data = compute_pair_data(pairing, times_of_rank, sizes);
+            }
+        }
         
-        mc::clear_file("mpi_pingpong.txt");
-        mc::export_containers("mpi_pingpong.txt", {"size", "time", "error"}, sizes, times, times_err);
+        if( rank == reporter )
+        {
+            std::cout << std::fixed;
+            std::cout << "RESULTS:" << std::endl; 
+            
+            auto timedat = compute_time_data(times, times_err, sizes);
+            auto latency = timedat.min_avg;
+            
+            std::cout << "- min_time         = ( " << timedat.min_avg*1.0e6 << " +- " << timedat.min_err*1.0e6 << " ) us    => latency" << std::endl;
+            std::cout << "- size @min_time   = " << timedat.min_size << " B" << std::endl;
+            
+            std::cout << "- max_time         = ( " << timedat.max_avg*1.0e6 << " +- " << timedat.max_err*1.0e6 << " ) us" << std::endl;
+            std::cout << "- size @max_time   = " << timedat.max_size << " B" << std::endl;
+            
+            auto mbndws = compute_bandwidth_data(latency, times, sizes);
+            
+            std::cout << "- bandwidth range  = [ " << mbndws.min/1.0e9 << ", " << mbndws.max/1.0e9 << " ] GB/s" << std::endl;
+            std::cout << "- bandwidth value  = ( " << mbndws.avg/1.0e9 << " +- " << mbndws.err/1.0e9 << " ) GB/s" << std::endl;
+            
+            const std::string filename = opt.output + "mpi_pingpong" + (non_blocking ? "_nonblocking" : "");
+            
+            write_results(filename, metadata, {"size", "time", "error"}, sizes, times, times_err);
+            
+            print_percentiles("", percentiles);
+            export_percentiles(opt.output + "mpi_pingpong" + (non_blocking ? "_nonblocking" : "") + "_latency", metadata, percentiles);
+            
+            if( pairs > 1 )
+            {
+                print_pairs("", pair_data);
+                export_pairs(opt.output + "mpi_pingpong" + (non_blocking ? "_nonblocking" : "") + "_pairs_" + opt.pairing, metadata, pair_data);
+            }
+        }
     }
     
     MPI_Finalize();
 }
-
@@ -0,0 +1,214 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <chrono>
+
+#include "my_mpi.hpp"
+#include "mcl.hpp"
+#include "result.hpp"
+#include "options.hpp"
+#include "histogram.hpp"
+#include "pairs.hpp"
+#include "collect_my_mpi.hpp"
+#include "timer.hpp"
+
+/*
+ * the ping-pong of pingpong_mpi.cpp on top of my_mpi, so the three can be compared:
+ *
+ *   vector   send_data(container) and recv_data<T>(id), which hands out a new vector
+ *   buffer   send_data(pointer, count) and recv_data(id, pointer, count) into a fixed buffer
+ */
+typedef char byte_t;
+
+const int pingpong_id = 0;
+const int gather_id   = 1000;   // + rank of the sender
+
+double benchmark_loop(my_mpi &mpi, std::vector<byte_t> &data, int destination, bool first, bool into_buffer, const pingpong_options_t &opt, latency_histogram &latencies)
+{
+    auto exchange = [&]()
+    {
+        auto receive = [&]()
+        {
+            if( into_buffer )
+                mpi.recv_data(pingpong_id, data.data(), data.size());
+            else
+                data = mpi.recv_data<byte_t>(pingpong_id);
+        };
+
+        if( first )
+        {
+            mpi.send_data(destination, pingpong_id, data);
+            receive();
+        }
+        else
+        {
+            receive();
+            mpi.send_data(destination, pingpong_id, data);
+        }
+    };
+
+    for(int n=0; n<opt.warmup && destination >= 0; ++n)
+        exchange();
+
+    mpi.barrier();
+    auto t_0 = bench_clock::now();
+
+    for(int n=0; n<opt.round_trips && destination >= 0; ++n)
+    {
+        auto t_start = bench_clock::now();
+
+        exchange();
+
+        // only meaningful on the rank that sends first, the other one includes its wait
+        latencies.record((bench_clock::now() - t_start) / 2);
+    }
+
+    // the time of this pair only, the other pairs may still be running
+    auto t_1 = bench_clock::now();
+    mpi.barrier();
+
+    return std::chrono::duration<double>(t_1 - t_0).count() / (2*opt.round_trips);
+}
+
+int main(int argc, char ** argv)
+{
+    const std::vector<std::string> all_tests = { "vector", "buffer" };
+
+    pingpong_options_t defaults;
+    defaults.tests = { "vector" };
+    defaults.warmup = 50;
+    defaults.max_size = 1024 * 1024; // ca. 1 MB
+
+    my_mpi mpi;
+
+    const int rank = mpi.rank();
+    const int size = mpi.world_size();
+
+    pingpong_options_t opt;
+
+    try
+    {
+        opt = parse_options(argc, argv, defaults, all_tests);
+
+        // no size limit of its own here, so --max-size=0 leaves no size at all
+        if( opt.sizes(opt.max_size).empty() )
+            throw std::runtime_error("empty size range, see --help");
+    }
+    catch(std::runtime_error &e)
+    {
+        if( rank == 0 ) { std::cerr << e.what() << std::endl; print_usage(argv[0], defaults, all_tests); }
+        mpi.exit(1);
+    }
+
+    if( opt.help )
+    {
+        if( rank == 0 ) print_usage(argv[0], defaults, all_tests);
+        return 0;
+    }
+
+    // all pairs run at the same time, the first rank of the first pair reports
+    std::vector<int> host_of;
+    for(int r=0; r<size; ++r) host_of.push_back(mpi.node_leader(r));
+
+    // a mode that leaves no pair, e.g. --pairs=inter on a single host, is an option error
+    pairing_t pairing;
+
+    try { pairing = make_pairing(host_of, opt.pairing, opt.seed); }
+    catch(std::runtime_error &e)
+    {
+        if( rank == 0 ) { std::cerr << e.what() << std::endl; print_usage(argv[0], defaults, all_tests); }
+        mpi.exit(1);
+    }
+
+    const auto pairs = pairing.firsts().size();
+    const int reporter = pairing.reporter();
+
+    auto metadata = my_mpi_metadata(mpi, "my_mpi_pingpong", my_mpi_config(), reporter);
+    metadata.set_options(opt, {"pairing", "seed"});
+
+    const auto message_sizes = opt.sizes(opt.max_size);
+
+    for(auto &test : opt.tests)
+    {
+        const bool into_buffer = ( test == "buffer" );
+
+        std::vector<int> sizes;
+        std::vector<double> times;
+        std::vector<double> times_err;
+        percentile_data_t percentiles;
+
+        if(rank == reporter )
+        {
+            std::cout << "PING-PONG BENCHMARK";
+            std::cout << (opt.warmup > 0 ? " \\w warmup" : " \\wo warmup");
+            std::cout << (into_buffer ? " \\buffer" : " \\vector");
+            std::cout <<std::endl;
+            std::cout << "- ping-pong sizes: [ " << message_sizes.front() << " B, " << message_sizes.back()/1.0e6 << " MB ]" << std::endl;
+            std::cout << "- round trips: " << opt.round_trips << ", warmup: " << opt.warmup << ", iterations: " << opt.iterations << std::endl;
+            std::cout << "- timer: " << timer_description() << std::endl;
+
+            if( pairs > 1 )
+                std::cout << "- pairs: " << pairs << " (" << opt.pairing << "), the single pair results are those of pair 0" << std::endl;
+        }
+
+        for(auto message_size : message_sizes)
+        {
+            std::vector<double> t;
+            std::vector<byte_t> data(message_size);
+            latency_histogram latencies;
+
+            for(int i=0; i<opt.iterations; ++i)
+                t.push_back( benchmark_loop(mpi, data, pairing.peer(rank), pairing.first(rank), into_buffer, opt, latencies) );
+
+            percentiles.add(message_size, latencies);
+
+            sizes.push_back(message_size);
+            times.push_back(mc::average(t));
+            times_err.push_back(mc::standard_deviation(t));
+        }
+
+        // collect the times of all pairs
+        pair_data_t pair_data;
+
+        if( pairs > 1 )
+        {
+            if( rank != reporter )
+            {
+                mpi.send_data(reporter, gather_id + rank, times);
+            }
+            else
+            {
+                std::vector<std::vector<double>> times_of_rank;
+
+                for(int r=0; r<size; ++r)
+                    times_of_rank.push_back( r == rank ? times : mpi.recv_data<double>(gather_id + r) );
+
+                pair_data = compute_pair_data(pairing, times_of_rank, sizes);
+            }
+        }
+
+        if( rank == reporter )
+        {
+            std::cout << std::fixed;
+            std::cout << "RESULTS:" << std::endl;
+
+            print_time_data("", times, times_err, sizes);
+
+            const std::string filename = opt.output + "my_mpi_pingpong_" + test;
+
+            write_results(filename, metadata, {"size", "time", "error"}, sizes, times, times_err);
+
+            print_percentiles("", percentiles);
+            export_percentiles(filename + "_latency", metadata, percentiles);
+
+            if( pairs > 1 )
+            {
+                print_pairs("", pair_data);
+                export_pairs(filename + "_pairs_" + opt.pairing, metadata, pair_data);
+            }
+        }
+
+        mpi.barrier();
+    }
+}
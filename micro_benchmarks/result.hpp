@@ -5,7 +5,12 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <iomanip>
+#include <string>
 #include "mcl.hpp"
+#include "histogram.hpp"
+#include "pairs.hpp"
+#include "result_writer.hpp"
 
 struct bandwidth_data_t
 {
@@ -40,6 +45,10 @@ bandwidth_data_t compute_bandwidth_data(double latency, const std::vector<double
         
     bandwidths.erase( std::remove(bandwidths.begin(), bandwidths.end(), 0.0), bandwidths.end() );
         
+    // no size took clearly longer than the latency, e.g. a narrow size range
+    if( bandwidths.empty() )
+        return { 0.0, 0.0, 0.0, 0.0 };
+        
     auto bndw_min = *std::min_element(bandwidths.begin(), bandwidths.end());
     auto bndw_max = *std::max_element(bandwidths.begin(), bandwidths.end());
     auto bndw_avg = mc::average(bandwidths);
@@ -49,4 +58,206 @@ bandwidth_data_t compute_bandwidth_data(double latency, const std::vector<double
 }
     
 
+// the summary of a size sweep, label e.g. "medium: "
+void print_time_data(const std::string &label, const std::vector<double> &times, const std::vector<double> &times_err, const std::vector<int> &sizes)
+{
+    auto tdata = compute_time_data(times, times_err, sizes);
+    auto bndws = compute_bandwidth_data(tdata.min_avg, times, sizes);
+    
+    std::cout << "- " << label << "min_time         = ( " << tdata.min_avg*1.0e6 << " +- " << tdata.min_err*1.0e6 << " ) us    => latency" << std::endl;
+    std::cout << "- " << label << "size @min_time   = " << tdata.min_size << " B" << std::endl;
+    
+    std::cout << "- " << label << "max_time         = ( " << tdata.max_avg*1.0e6 << " +- " << tdata.max_err*1.0e6 << " ) us" << std::endl;
+    std::cout << "- " << label << "size @max_time   = " << tdata.max_size << " B" << std::endl;
+    
+    std::cout << "- " << label << "bandwidth range  = [ " << bndws.min/1.0e9 << ", " << bndws.max/1.0e9 << " ] GB/s" << std::endl;
+    std::cout << "- " << label << "bandwidth value  = ( " << bndws.avg/1.0e9 << " +- " << bndws.err/1.0e9 << " ) GB/s" << std::endl;
+}
+
+/*
+ * for every size measured by any of the tests the one with the shortest time, title e.g.
+ * "lowest latency per size". only tests measuring the same thing belong in one table.
+ */
+void print_fastest(const std::string &title, const std::vector<std::string> &labels, const std::vector<std::vector<int>> &sizes, 
+                   const std::vector<std::vector<double>> &times)
+{
+    std::vector<int> all_sizes;
+    
+    for(auto &s : sizes)
+        all_sizes.insert(all_sizes.end(), s.begin(), s.end());
+    
+    std::sort(all_sizes.begin(), all_sizes.end());
+    all_sizes.erase(std::unique(all_sizes.begin(), all_sizes.end()), all_sizes.end());
+    
+    std::cout << "- " << title << std::endl;
+    std::cout << "  " << std::setw(14) << "size" << std::setw(16) << "test" << std::setw(14) << "time [us]" << std::setw(18) << "next" << std::endl;
+    
+    for(auto size : all_sizes)
+    {
+        // (time, test) of all tests that measured this size
+        std::vector<std::pair<double, std::string>> candidates;
+        
+        for(std::size_t t=0; t<labels.size(); ++t)
+        {
+            auto it = std::find(sizes[t].begin(), sizes[t].end(), size);
+            
+            if( it != sizes[t].end() )
+                candidates.emplace_back(times[t][it - sizes[t].begin()], labels[t]);
+        }
+        
+        std::sort(candidates.begin(), candidates.end());
+        
+        std::cout << "  " << std::setw(12) << size << " B" << std::setw(16) << candidates[0].second << std::setprecision(3)
+                  << std::setw(14) << candidates[0].first*1.0e6 << std::setw(18) << (candidates.size() > 1 ? candidates[1].second : "-") << std::endl;
+    }
+    
+    std::cout << std::setprecision(6);
+}
+
+// latency percentiles per message size, filled from one histogram per size
+struct percentile_data_t
+{
+    std::vector<int> sizes;
+    std::vector<double> min, p50, p90, p99, p999, max;
+    
+    void add(int size, const latency_histogram &latencies)
+    {
+        auto s = latencies.summary();
+        
+        sizes.push_back(size);
+        min.push_back(s.min);   p50.push_back(s.p50);   p90.push_back(s.p90);
+        p99.push_back(s.p99);   p999.push_back(s.p999); max.push_back(s.max);
+    }
+};
+
+void print_percentiles(const std::string &label, const percentile_data_t &data)
+{
+    std::cout << "- " << label << "latency percentiles [us]" << std::endl;
+    std::cout << "  " << std::setw(14) << "size" << std::setw(11) << "min" << std::setw(11) << "p50" << std::setw(11) << "p90"
+              << std::setw(11) << "p99" << std::setw(11) << "p99.9" << std::setw(11) << "max" << std::endl;
+    
+    for(std::size_t i=0; i<data.sizes.size(); ++i)
+    {
+        std::cout << "  " << std::setw(12) << data.sizes[i] << " B" << std::setprecision(3)
+                  << std::setw(11) << data.min[i]*1.0e6 << std::setw(11) << data.p50[i]*1.0e6 << std::setw(11) << data.p90[i]*1.0e6
+                  << std::setw(11) << data.p99[i]*1.0e6 << std::setw(11) << data.p999[i]*1.0e6 << std::setw(11) << data.max[i]*1.0e6 << std::endl;
+    }
+    
+    std::cout << std::setprecision(6);
+}
+
+void export_percentiles(const std::string &basename, const result_metadata_t &metadata, const percentile_data_t &data)
+{
+    write_results(basename, metadata, {"size", "min", "p50", "p90", "p99", "p99.9", "max"}, 
+                  data.sizes, data.min, data.p50, data.p90, data.p99, data.p999, data.max);
+}
+
+
+// results of every pair when several pairs run at once
+struct pair_data_t
+{
+    std::vector<int> pairs, first, second;
+    std::vector<double> latencies;      // shortest time over all sizes
+    std::vector<double> bandwidths;     // highest size / time over all sizes
+    double aggregate = 0.0;             // highest sum of the pairs' bandwidths at one size
+};
+
+// times_of_rank[r] holds the times per size measured by rank r, those of the first ranks of the pairs are used
+pair_data_t compute_pair_data(const pairing_t &pairing, const std::vector<std::vector<double>> &times_of_rank, const std::vector<int> &sizes)
+{
+    pair_data_t result;
+    std::vector<double> sum(sizes.size(), 0.0);
+    
+    auto firsts = pairing.firsts();
+    
+    for(std::size_t p=0; p<firsts.size(); ++p)
+    {
+        const auto &times = times_of_rank.at(firsts[p]);
+        double bandwidth = 0.0;
+        
+        for(std::size_t i=0; i<sizes.size(); ++i)
+        {
+            bandwidth = std::max(bandwidth, sizes[i] / times[i]);
+            sum[i] += sizes[i] / times[i];
+        }
+        
+        result.pairs.push_back(p);
+        result.first.push_back(firsts[p]);
+        result.second.push_back(pairing.peer(firsts[p]));
+        result.latencies.push_back(*std::min_element(times.begin(), times.end()));
+        result.bandwidths.push_back(bandwidth);
+    }
+    
+    result.aggregate = sum.empty() ? 0.0 : *std::max_element(sum.begin(), sum.end());
+    
+    return result;
+}
+
+void print_pairs(const std::string &label, const pair_data_t &data)
+{
+    auto spread = [&](const std::string &name, const std::vector<double> &values, double unit, const std::string &unit_name)
+    {
+        std::cout << "- " << label << name << " = [ " << *std::min_element(values.begin(), values.end())/unit << ", " 
+                  << *std::max_element(values.begin(), values.end())/unit << " ] " << unit_name << ", ( " 
+                  << mc::average(values)/unit << " +- " << mc::standard_deviation(values)/unit << " ) " << unit_name << std::endl;
+    };
+    
+    std::cout << "- " << label << "per pair" << std::endl;
+    std::cout << "  " << std::setw(6) << "pair" << std::setw(16) << "ranks" << std::setw(16) << "latency [us]" << std::setw(20) << "bandwidth [GB/s]" << std::endl;
+    
+    for(std::size_t i=0; i<data.pairs.size(); ++i)
+    {
+        const auto ranks = std::to_string(data.first[i]) + " <-> " + std::to_string(data.second[i]);
+        
+        std::cout << "  " << std::setw(6) << data.pairs[i] << std::setw(16) << ranks << std::setprecision(3)
+                  << std::setw(16) << data.latencies[i]*1.0e6 << std::setw(20) << data.bandwidths[i]/1.0e9 << std::endl;
+    }
+    
+    spread("latency spread   ", data.latencies, 1.0e-6, "us");
+    spread("bandwidth spread ", data.bandwidths, 1.0e9, "GB/s");
+    std::cout << "- " << label << "aggregate bandwidth = " << data.aggregate/1.0e9 << " GB/s" << std::endl;
+    std::cout << std::setprecision(6);
+}
+
+void export_pairs(const std::string &basename, const result_metadata_t &metadata, const pair_data_t &data)
+{
+    write_results(basename, metadata, {"pair", "first", "second", "latency", "bandwidth"}, 
+                  data.pairs, data.first, data.second, data.latencies, data.bandwidths);
+}
+
+
+// collective latencies per payload size, from the average time per operation of every rank
+struct collective_data_t
+{
+    std::vector<int> sizes;
+    std::vector<double> avg, min, max;      // over the ranks
+    
+    void add(int size, const std::vector<double> &rank_times)
+    {
+        sizes.push_back(size);
+        avg.push_back(mc::average(rank_times));
+        min.push_back(*std::min_element(rank_times.begin(), rank_times.end()));
+        max.push_back(*std::max_element(rank_times.begin(), rank_times.end()));
+    }
+};
+
+void print_collective(const std::string &label, const collective_data_t &data)
+{
+    std::cout << "- " << label << " latency over the ranks [us]" << std::endl;
+    std::cout << "  " << std::setw(14) << "size" << std::setw(11) << "avg" << std::setw(11) << "min" << std::setw(11) << "max" << std::endl;
+    
+    for(std::size_t i=0; i<data.sizes.size(); ++i)
+    {
+        std::cout << "  " << std::setw(12) << data.sizes[i] << " B" << std::setprecision(3)
+                  << std::setw(11) << data.avg[i]*1.0e6 << std::setw(11) << data.min[i]*1.0e6 << std::setw(11) << data.max[i]*1.0e6 << std::endl;
+    }
+    
+    std::cout << std::setprecision(6);
+}
+
+void export_collective(const std::string &basename, const result_metadata_t &metadata, const collective_data_t &data)
+{
+    write_results(basename, metadata, {"size", "avg", "min", "max"}, data.sizes, data.avg, data.min, data.max);
+}
+
 #endif
@@ -0,0 +1,266 @@
+#ifndef RESULT_WRITER_HPP
+#define RESULT_WRITER_HPP
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <cmath>
+#include <ctime>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+#include "options.hpp"
+#include "timer.hpp"
+
+/*
+ * result files with a metadata block, every table is written once as <basename>.csv and once
+ * as <basename>.json, each in a single pass over the rows:
+ *
+ *   # benchmark: gasnet_pingpong          {
+ *   # conduit: ibv                          "metadata": { "benchmark": "gasnet_pingpong", ... },
+ *   size,time,error                         "columns": [ "size", "time", "error" ],
+ *   8,1.2345e-06,1.2e-08                    "rows": [ [ 8, 1.2345e-06, 1.2e-08 ], ... ]
+ *                                         }
+ */
+class result_metadata_t
+{
+public:
+    // compiler, date and timer of this build, benchmark names the program
+    explicit result_metadata_t(const std::string &benchmark)
+    {
+        set("benchmark", benchmark);
+#if defined(__clang__)
+        set("compiler", std::string("clang ") + __clang_version__);
+#elif defined(__GNUC__)
+        set("compiler", std::string("gcc ") + __VERSION__);
+#else
+        set("compiler", "unknown");
+#endif
+        char date[32];
+        auto now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+        set("date", date);
+
+        timer_init();
+        set("timer", timer_name());
+        set("timer_resolution", timer_state.resolution);
+        set("timer_overhead", timer_state.overhead);
+    }
+
+    // replaces the value of an existing key, new keys are appended
+    template<typename T>
+    void set(const std::string &key, const T &value)
+    {
+        std::stringstream stream;
+        stream << value;
+
+        auto it = std::find_if(m_entries.begin(), m_entries.end(), [&](const std::pair<std::string, std::string> &e){ return e.first == key; });
+        auto index = it - m_entries.begin();
+
+        if( it == m_entries.end() )
+        {
+            m_entries.emplace_back(key, std::string());
+            m_numeric.push_back(false);
+        }
+
+        m_entries[index].second = stream.str();
+        m_numeric[index] = is_number(value, std::is_arithmetic<T>());
+    }
+
+    // hostname_of[r] is the host of rank r: the distinct hosts and the host index of every rank
+    void set_hosts(const std::vector<std::string> &hostname_of)
+    {
+        std::vector<std::string> hosts;
+        std::stringstream placement;
+
+        for(std::size_t r=0; r<hostname_of.size(); ++r)
+        {
+            auto it = std::find(hosts.begin(), hosts.end(), hostname_of[r]);
+            placement << (r ? " " : "") << (it - hosts.begin());
+
+            if( it == hosts.end() ) hosts.push_back(hostname_of[r]);
+        }
+
+        std::stringstream names;
+        for(std::size_t h=0; h<hosts.size(); ++h) names << (h ? " " : "") << hosts[h];
+
+        set("ranks", hostname_of.size());
+        set("hosts", names.str());
+        set("placement", placement.str());
+    }
+
+    /*
+     * the run parameters of the benchmarks sharing options.hpp: the size sweep and repetitions,
+     * which all of them use, and of windows, reply, segment_size, pairing and seed only those
+     * named in extras, so a result file records no option its benchmark ignores.
+     */
+    void set_options(const pingpong_options_t &opt, const std::vector<std::string> &extras)
+    {
+        auto used = [&](const std::string &key){ return std::find(extras.begin(), extras.end(), key) != extras.end(); };
+
+        std::stringstream tests, windows;
+        for(std::size_t i=0; i<opt.tests.size(); ++i)   tests << (i ? "," : "") << opt.tests[i];
+        for(std::size_t i=0; i<opt.windows.size(); ++i) windows << (i ? "," : "") << opt.windows[i];
+
+        set("tests", tests.str());
+        set("min_size", opt.min_size);
+        set("max_size", opt.max_size);
+        set("step", (opt.step_add ? "+" : "") + std::to_string(opt.step));
+        set("round_trips", opt.round_trips);
+        set("warmup", opt.warmup);
+        set("iterations", opt.iterations);
+
+        if( used("windows") )      set("windows", windows.str());
+        if( used("reply") )        set("reply", opt.reply);
+        if( used("segment_size") ) set("segment_size", opt.segment_size);
+        if( used("pairing") )      set("pairing", opt.pairing);
+        if( used("seed") )         set("seed", opt.seed);
+    }
+
+    const std::vector<std::pair<std::string, std::string>> &entries() const { return m_entries; }
+
+    // true if entry i was set from a number, JSON writes it without quotes
+    bool numeric(std::size_t i) const { return m_numeric[i]; }
+
+private:
+    template<typename T>
+    static bool is_number(const T &value, std::true_type /* arithmetic */) { return std::isfinite(static_cast<double>(value)); }
+
+    template<typename T>
+    static bool is_number(const T &, std::false_type) { return false; }
+
+    std::vector<std::pair<std::string, std::string>> m_entries;
+    std::vector<bool> m_numeric;
+};
+
+namespace rw
+{
+    inline std::string json_string(const std::string &s)
+    {
+        std::stringstream out;
+        out << '"';
+
+        for(char c : s)
+        {
+            if( c == '"' || c == '\\' )                 out << '\\' << c;
+            else if( c == '\n' )                        out << "\\n";
+            else if( static_cast<unsigned char>(c) < 0x20 ) out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+            else                                        out << c;
+        }
+
+        out << '"';
+        return out.str();
+    }
+
+    // doubles keep all their digits, JSON has no inf and nan
+    template<typename T>
+    void write_value(std::ostream &out, const T &value, bool json, std::true_type /* floating point */)
+    {
+        if( json && !std::isfinite(value) )
+            out << "null";
+        else
+            out << std::setprecision(std::numeric_limits<T>::max_digits10) << value;
+    }
+
+    template<typename T>
+    void write_value(std::ostream &out, const T &value, bool, std::false_type)
+    {
+        out << value;
+    }
+
+    inline void write_row(std::ostream &, std::size_t, bool)
+    {
+    }
+
+    template<class container_t, class ... containers_t>
+    void write_row(std::ostream &out, std::size_t row, bool json, const container_t &container, const containers_t& ... remaining)
+    {
+        using value_t = typename container_t::value_type;
+
+        write_value(out, container[row], json, std::is_floating_point<value_t>());
+
+        if( sizeof...(remaining) > 0 )
+            out << (json ? ", " : ",");
+
+        write_row(out, row, json, remaining...);
+    }
+}
+
+/*
+ * writes the containers as columns of basename.csv and basename.json, overwriting both.
+ * throws std::runtime_error if headers and containers don't match or the file can't be written.
+ */
+template<class ... containers_t>
+void write_results(const std::string &basename, const result_metadata_t &metadata, const std::vector<std::string> &headers,
+                   const containers_t& ... containers)
+{
+    const std::vector<std::size_t> sizes = { containers.size()... };
+
+    if( headers.size() != sizes.size() )
+        throw std::runtime_error("number of headers must match number of containers");
+
+    if( std::adjacent_find(sizes.begin(), sizes.end(), std::not_equal_to<std::size_t>()) != sizes.end() )
+        throw std::runtime_error("vector sizes do not match!");
+
+    const std::size_t rows = sizes.empty() ? 0 : sizes.front();
+
+    // csv
+    {
+        std::ofstream file(basename + ".csv", std::ios::out | std::ios::trunc);
+
+        if( !file )
+            throw std::runtime_error("can't write " + basename + ".csv");
+
+        for(auto &e : metadata.entries())
+            file << "# " << e.first << ": " << e.second << '\n';
+
+        for(std::size_t i=0; i<headers.size(); ++i)
+            file << (i ? "," : "") << headers[i];
+        file << '\n';
+
+        for(std::size_t row=0; row<rows; ++row)
+        {
+            rw::write_row(file, row, false, containers...);
+            file << '\n';
+        }
+    }
+
+    // json
+    {
+        std::ofstream file(basename + ".json", std::ios::out | std::ios::trunc);
+
+        if( !file )
+            throw std::runtime_error("can't write " + basename + ".json");
+
+        file << "{\n  \"metadata\": {";
+
+        for(std::size_t i=0; i<metadata.entries().size(); ++i)
+        {
+            auto &e = metadata.entries()[i];
+            file << (i ? ",\n    " : "\n    ") << rw::json_string(e.first) << ": " << (metadata.numeric(i) ? e.second : rw::json_string(e.second));
+        }
+
+        file << "\n  },\n  \"columns\": [ ";
+
+        for(std::size_t i=0; i<headers.size(); ++i)
+            file << (i ? ", " : "") << rw::json_string(headers[i]);
+
+        file << " ],\n  \"rows\": [";
+
+        for(std::size_t row=0; row<rows; ++row)
+        {
+            file << (row ? ",\n    [ " : "\n    [ ");
+            rw::write_row(file, row, true, containers...);
+            file << " ]";
+        }
+
+        file << "\n  ]\n}\n";
+    }
+}
+
+#endif
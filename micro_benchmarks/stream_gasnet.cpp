@@ -0,0 +1,262 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <algorithm>
+#include <gasnet.h>
+#include <chrono>
+#include <vector>
+#include <string>
+
+#include "mcl.hpp"
+#include "options.hpp"
+#include "test_stream.hpp"
+#include "collect.hpp"
+#include "timer.hpp"
+
+/*
+ * message rate and streaming bandwidth: rank 0 keeps a window of operations in flight
+ * to rank 1, which counts the arrivals. the bidirectional tests let both ranks stream
+ * to each other at the same time and compare that with one direction alone.
+ */
+struct stream_data_t
+{
+    std::vector<int> sizes;
+    std::vector<int> windows;
+    std::vector<double> rates;
+    std::vector<double> rates_err;
+    std::vector<double> bandwidths;
+};
+
+stream_data_t run_stream(stream_kind_t kind, const std::vector<std::size_t> &sizes, const pingpong_options_t &opt)
+{
+    stream_data_t result;
+
+    const int rank = gasnet_mynode();
+    const int peer = ( rank == 0 ? 1 : 0 );
+
+    for(auto size : sizes)
+    {
+        for(auto window : opt.windows)
+        {
+            if( opt.warmup > 0 )
+                benchmark_stream(kind, size, window, opt.warmup, peer, rank == 0, rank == 1);
+
+            std::vector<double> rates;
+
+            for(int i=0; i<opt.iterations; ++i)
+                rates.push_back( opt.round_trips / benchmark_stream(kind, size, window, opt.round_trips, peer, rank == 0, rank == 1) );
+
+            result.sizes.push_back(size);
+            result.windows.push_back(window);
+            result.rates.push_back(mc::average(rates));
+            result.rates_err.push_back(mc::standard_deviation(rates));
+            result.bandwidths.push_back(mc::average(rates) * size);
+        }
+    }
+
+    return result;
+}
+
+struct bidir_data_t
+{
+    std::vector<int> sizes;
+    std::vector<int> windows;
+    std::vector<double> unidirectional;
+    std::vector<double> forward;        // 0 -> 1, while 1 -> 0 is active
+    std::vector<double> backward;       // 1 -> 0, while 0 -> 1 is active
+    std::vector<double> aggregate;
+    std::vector<double> forward_received;   // forward and backward timed by the receiver, 0 for puts
+    std::vector<double> backward_received;
+};
+
+/*
+ * bandwidths are measured by every rank for its own sends, up to the last completion and
+ * without waiting for the peer's stream, and for its arrivals on their own. rank 0 collects them.
+ */
+bidir_data_t run_bidir(stream_kind_t kind, const std::vector<std::size_t> &sizes, const pingpong_options_t &opt)
+{
+    bidir_data_t result;
+    std::vector<double> own_received;
+
+    const int rank = gasnet_mynode();
+    const int peer = ( rank == 0 ? 1 : 0 );
+
+    for(auto size : sizes)
+    {
+        for(auto window : opt.windows)
+        {
+            if( opt.warmup > 0 )
+                benchmark_stream(kind, size, window, opt.warmup, peer, true, true);
+
+            std::vector<double> uni, sent, received;
+
+            for(int i=0; i<opt.iterations; ++i)
+            {
+                double receive_time = 0;
+
+                uni.push_back( opt.round_trips * size / benchmark_stream(kind, size, window, opt.round_trips, peer, rank == 0, rank == 1) );
+                sent.push_back( opt.round_trips * size / benchmark_stream(kind, size, window, opt.round_trips, peer, true, true, &receive_time) );
+                received.push_back( receive_time > 0 ? opt.round_trips * size / receive_time : 0.0 );
+            }
+
+            result.sizes.push_back(size);
+            result.windows.push_back(window);
+            result.unidirectional.push_back(mc::average(uni));
+            result.forward.push_back(mc::average(sent));
+            own_received.push_back(mc::average(received));
+        }
+    }
+
+    auto gathered_sent = gather_results(result.forward, 0);
+    auto gathered_received = gather_results(own_received, 0);
+
+    if( rank == 0 )
+    {
+        result.backward = gathered_sent[1];
+
+        // rank 1 received the forward stream, rank 0 the backward one
+        result.forward_received = gathered_received[1];
+        result.backward_received = own_received;
+
+        for(std::size_t i=0; i<result.forward.size(); ++i)
+            result.aggregate.push_back(result.forward[i] + result.backward[i]);
+    }
+
+    return result;
+}
+
+void print_bidir(const std::string &label, const bidir_data_t &data)
+{
+    std::cout << "- " << label << " bandwidth [GB/s]" << std::endl;
+    std::cout << "  " << std::setw(14) << "size" << std::setw(8) << "window" << std::setw(10) << "uni"
+              << std::setw(10) << "0->1" << std::setw(10) << "1->0" << std::setw(10) << "0->1 rx" << std::setw(10) << "1->0 rx"
+              << std::setw(10) << "both" << std::setw(10) << "both/uni" << std::endl;
+
+    for(std::size_t i=0; i<data.sizes.size(); ++i)
+    {
+        std::cout << "  " << std::setw(12) << data.sizes[i] << " B" << std::setw(8) << data.windows[i] << std::setprecision(3)
+                  << std::setw(10) << data.unidirectional[i]/1.0e9 << std::setw(10) << data.forward[i]/1.0e9
+                  << std::setw(10) << data.backward[i]/1.0e9 << std::setw(10) << data.forward_received[i]/1.0e9
+                  << std::setw(10) << data.backward_received[i]/1.0e9 << std::setw(10) << data.aggregate[i]/1.0e9
+                  << std::setw(10) << data.aggregate[i] / data.unidirectional[i] << std::endl;
+    }
+
+    std::cout << std::setprecision(6);
+}
+
+void print_stream(const std::string &label, const stream_data_t &data)
+{
+    std::cout << "- " << label << std::endl;
+    std::cout << "  " << std::setw(14) << "size" << std::setw(8) << "window"
+              << std::setw(22) << "rate [Mmsg/s]" << std::setw(18) << "bandwidth [GB/s]" << std::endl;
+
+    for(std::size_t i=0; i<data.sizes.size(); ++i)
+    {
+        std::cout << "  " << std::setw(12) << data.sizes[i] << " B" << std::setw(8) << data.windows[i] << std::setprecision(4)
+                  << std::setw(10) << data.rates[i]/1.0e6 << " +- " << std::setw(8) << data.rates_err[i]/1.0e6
+                  << std::setw(18) << data.bandwidths[i]/1.0e9 << std::endl;
+    }
+
+    std::cout << std::setprecision(6);
+}
+
+int main(int argc, char ** argv)
+{
+    std::vector<gasnet_handlerentry_t> handlers = {
+        { stream_short_id,  (void(*)())stream_short_handler },
+        { stream_medium_id, (void(*)())stream_medium_handler },
+        { stream_long_id,   (void(*)())stream_long_handler },
+        { stream_ack_id,    (void(*)())stream_ack_handler },
+        { collect_id,       (void(*)())collect_handler }
+    };
+
+    const std::vector<std::string> all_tests = { "short", "medium", "long", "put", "bidir_medium", "bidir_long", "bidir_put" };
+    const std::vector<stream_kind_t> kinds = { stream_kind_t::short_am, stream_kind_t::medium_am, stream_kind_t::long_am, stream_kind_t::put,
+                                               stream_kind_t::medium_am, stream_kind_t::long_am, stream_kind_t::put };
+
+    gasnet_init(&argc, &argv);
+
+    pingpong_options_t defaults;
+    defaults.round_trips = 1000;
+    defaults.iterations = 10;
+    pingpong_options_t opt;
+
+    try
+    {
+        opt = parse_options(argc, argv, defaults, all_tests);
+
+        if( gasnet_nodes() != 2 )
+            throw std::runtime_error("must run with 2 processes");
+    }
+    catch(std::runtime_error &e)
+    {
+        if( gasnet_mynode() == 0 ) { std::cerr << e.what() << std::endl; print_usage(argv[0], defaults, all_tests); }
+        gasnet_exit(1);
+    }
+
+    if( opt.help )
+    {
+        if( gasnet_mynode() == 0 ) print_usage(argv[0], defaults, all_tests);
+        gasnet_exit(0);
+    }
+
+    gasnet_attach(handlers.data(), handlers.size(), opt.segment_size, 0);
+
+    int rank = gasnet_mynode();
+
+    const auto metadata = gasnet_metadata("gasnet_stream", opt, {"windows", "segment_size"}, 0);
+
+    if( rank == 0 )
+    {
+        std::cout << "STREAMING BENCHMARK" << std::endl;
+        std::cout << "- messages: " << opt.round_trips << ", warmup: " << opt.warmup << ", iterations: " << opt.iterations << std::endl;
+        std::cout << "- timer: " << timer_description() << std::endl;
+    }
+
+    for(std::size_t t=0; t<all_tests.size(); ++t)
+    {
+        if( !opt.has_test(all_tests[t]) )
+            continue;
+
+        // short messages carry no payload
+        auto sizes = kinds[t] == stream_kind_t::short_am ? std::vector<std::size_t>{ 0 } : opt.sizes(stream_max_size(kinds[t], opt.segment_size));
+
+        if( rank == 0 ) std::cout << "- streaming " << all_tests[t] << std::endl;
+
+        if( all_tests[t].compare(0, 6, "bidir_") == 0 )
+        {
+            auto data = run_bidir(kinds[t], sizes, opt);
+
+            if( rank == 0 )
+            {
+                std::cout << std::fixed;
+                std::cout << "RESULTS:" << std::endl;
+
+                print_bidir(all_tests[t], data);
+
+                write_results(opt.output + "gasnet_stream_" + all_tests[t], metadata, {"size", "window", "uni", "forward", "backward", "forward_received", "backward_received", "aggregate"},
+                                      data.sizes, data.windows, data.unidirectional, data.forward, data.backward,
+                                      data.forward_received, data.backward_received, data.aggregate);
+            }
+
+            continue;
+        }
+
+        auto data = run_stream(kinds[t], sizes, opt);
+
+        if( rank == 0 )
+        {
+            std::cout << std::fixed;
+            std::cout << "RESULTS:" << std::endl;
+
+            print_stream(all_tests[t], data);
+
+            write_results(opt.output + "gasnet_stream_" + all_tests[t], metadata, {"size", "window", "rate", "error", "bandwidth"},
+                                  data.sizes, data.windows, data.rates, data.rates_err, data.bandwidths);
+        }
+    }
+
+    BARRIER();
+    gasnet_exit(0);
+    return 0;
+}
@@ -0,0 +1,219 @@
+#ifndef TEST_COLLECTIVE_HPP
+#define TEST_COLLECTIVE_HPP
+
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+#include <iostream>
+#include <atomic>
+#include <cstring>
+
+#include <gasnet.h>
+
+#include "options.hpp"
+#include "timer.hpp"
+
+#ifndef BARRIER
+#define BARRIER()                                           \
+do {                                                        \
+  gasnet_barrier_notify(0,GASNET_BARRIERFLAG_ANONYMOUS);    \
+  gasnet_barrier_wait(0,GASNET_BARRIERFLAG_ANONYMOUS);      \
+} while (0)
+#endif
+
+// global data for the AM tree, the counters only grow so that consecutive operations can't mix up
+namespace tr
+{
+    std::atomic<long> up{ 0 };
+    std::atomic<long> down{ 0 };
+    long up_expected = 0;
+    long down_expected = 0;
+}
+
+const gasnet_handler_t tree_up_id        = 211;
+const gasnet_handler_t tree_down_id      = 212;
+const gasnet_handler_t tree_up_data_id   = 213;
+const gasnet_handler_t tree_down_data_id = 214;
+
+void tree_up_handler(gasnet_token_t)
+{
+    tr::up++;
+}
+
+void tree_down_handler(gasnet_token_t)
+{
+    tr::down++;
+}
+
+void tree_up_data_handler(gasnet_token_t, void *, size_t)
+{
+    tr::up++;
+}
+
+void tree_down_data_handler(gasnet_token_t, void *, size_t)
+{
+    tr::down++;
+}
+
+/*
+ * binomial tree rooted at rank 0: the parent of a rank is the rank without its lowest set bit,
+ * so the children of r are r + 2^k for all 2^k below that bit. the segment holds the broadcast
+ * buffer at slot 0 and the partial results of the children at slot 1 + k.
+ */
+struct tree_t
+{
+    int rank;
+    int parent = -1;
+    std::vector<int> children;
+
+    tree_t(int rank, int nodes) : rank(rank)
+    {
+        const int low = rank & -rank;
+
+        if( rank != 0 )
+            parent = rank - low;
+
+        for(int step = 1; (rank == 0 || step < low) && rank + step < nodes; step <<= 1)
+            children.push_back(rank + step);
+    }
+
+    // slot of this rank in its parent's segment
+    int slot() const { return 1 + __builtin_ctz(rank); }
+};
+
+void tree_barrier(const tree_t &tree)
+{
+    const long up_expected = tr::up_expected += tree.children.size();
+    GASNET_BLOCKUNTIL( tr::up >= up_expected );
+
+    if( tree.parent >= 0 )
+    {
+        gasnet_AMRequestShort0(tree.parent, tree_up_id);
+
+        const long down_expected = ++tr::down_expected;
+        GASNET_BLOCKUNTIL( tr::down >= down_expected );
+    }
+
+    for(auto c : tree.children)
+        gasnet_AMRequestShort0(c, tree_down_id);
+}
+
+// data of rank 0 to data of all ranks, forwarded from the segment of every inner rank
+void tree_broadcast(const tree_t &tree, double *data, std::size_t count, const std::vector<gasnet_seginfo_t> &seginfo)
+{
+    auto source = data;
+
+    if( tree.parent >= 0 )
+    {
+        const long down_expected = ++tr::down_expected;
+        GASNET_BLOCKUNTIL( tr::down >= down_expected );
+
+        source = static_cast<double *>(seginfo[tree.rank].addr);
+    }
+
+    for(auto c : tree.children)
+        gasnet_AMRequestLong0(c, tree_down_data_id, source, count*sizeof(double), seginfo[c].addr);
+
+    if( source != data && count != 0 )
+        std::memcpy(data, source, count*sizeof(double));
+}
+
+// sum of data over all ranks, complete in result of rank 0 only
+void tree_reduce(const tree_t &tree, const double *data, double *result, std::size_t count, const std::vector<gasnet_seginfo_t> &seginfo)
+{
+    const long up_expected = tr::up_expected += tree.children.size();
+    GASNET_BLOCKUNTIL( tr::up >= up_expected );
+
+    auto slots = static_cast<const double *>(seginfo[tree.rank].addr);
+
+    for(std::size_t i=0; i<count; ++i)
+    {
+        result[i] = data[i];
+
+        for(std::size_t k=0; k<tree.children.size(); ++k)
+            result[i] += slots[(1 + k)*count + i];
+    }
+
+    if( tree.parent >= 0 )
+        gasnet_AMRequestLong0(tree.parent, tree_up_data_id, result, count*sizeof(double), static_cast<double *>(seginfo[tree.parent].addr) + tree.slot()*count);
+}
+
+// largest payload whose broadcast buffer and child slots fit into the segment
+std::size_t tree_max_size(const tree_t &root, std::size_t segment_size)
+{
+    return segment_size / (1 + root.children.size()) / sizeof(double) * sizeof(double);
+}
+
+enum class collective_t { barrier, barrier_am, broadcast_am, reduce_am, allreduce_am };
+
+/*
+ * average time of one operation on this rank. barriers run back to back, the other operations
+ * are separated by a barrier outside of the measurement, like in the OSU benchmarks.
+ */
+double benchmark_collective(collective_t kind, std::size_t size, const tree_t &tree, const pingpong_options_t &opt)
+{
+    std::vector<gasnet_seginfo_t> seginfo(gasnet_nodes());
+    gasnet_getSegmentInfo(seginfo.data(), seginfo.size());
+
+    const std::size_t count = size / sizeof(double);
+    std::vector<double> data(count, tree.rank);
+    std::vector<double> result(count);
+
+    auto operation = [&]()
+    {
+        switch( kind )
+        {
+            case collective_t::barrier:      BARRIER(); break;
+            case collective_t::barrier_am:   tree_barrier(tree); break;
+            case collective_t::broadcast_am: tree_broadcast(tree, data.data(), count, seginfo); break;
+            case collective_t::reduce_am:    tree_reduce(tree, data.data(), result.data(), count, seginfo); break;
+            case collective_t::allreduce_am:
+                tree_reduce(tree, data.data(), result.data(), count, seginfo);
+                tree_broadcast(tree, result.data(), count, seginfo);
+                break;
+        }
+    };
+
+    const bool back_to_back = ( kind == collective_t::barrier || kind == collective_t::barrier_am );
+
+    // warm up
+    for(int n=0; n<opt.warmup; ++n)
+    {
+        BARRIER();
+        operation();
+    }
+
+    // benchmark
+    double time = 0.0;
+    BARRIER();
+
+    if( back_to_back )
+    {
+        auto t_0 = bench_clock::now();
+
+        for(int n=0; n<opt.round_trips; ++n)
+            operation();
+
+        auto t_1 = bench_clock::now();
+        time = std::chrono::duration<double>(t_1 - t_0).count();
+    }
+    else
+    {
+        for(int n=0; n<opt.round_trips; ++n)
+        {
+            BARRIER();
+            auto t_0 = bench_clock::now();
+
+            operation();
+
+            auto t_1 = bench_clock::now();
+            time += std::chrono::duration<double>(t_1 - t_0).count();
+        }
+    }
+
+    BARRIER();
+
+    return time / opt.round_trips;
+}
+
+#endif
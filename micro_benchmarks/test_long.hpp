@@ -11,6 +11,10 @@
 
 #include <gasnet.h>
 
+#include "options.hpp"
+#include "histogram.hpp"
+#include "timer.hpp"
+
 #ifndef BARRIER
 #define BARRIER()                                           \
 do {                                                        \
@@ -23,8 +27,7 @@ typedef char byte_t;
 
 namespace l
 {
-    const int N = 500;
-    const int N_warmup = 50;
+    bool reply = false;
     
     byte_t *data;
     int reply_number = 0;
@@ -44,12 +47,11 @@ void long_request_handler(gasnet_token_t token, void *buf, size_t size, int recv
     l::msg_recieved = true;   
     l::local_number = recv_number;
     
-#ifdef DO_REPLY
-    gasnet_AMReplyShort0(token, medium_rep_id);
-#endif
+    if( l::reply )
+        gasnet_AMReplyShort0(token, long_rep_id);
 }
 
-void long_reply_handler(gasnet_token_t token)
+void long_reply_handler(gasnet_token_t)
 {
     l::reply_number++;
 }
@@ -62,60 +64,68 @@ void send_long(byte_t *data, std::size_t size, int dest, void *dest_mem)
 }
 
 
-double benchmark_long(int message_size)
+double benchmark_long(int message_size, int neighbour, bool first, const pingpong_options_t &opt, latency_histogram &latencies)
 {    
     if( message_size > gasnet_AMMaxLongRequest() )
         throw std::runtime_error("message_size for medium must not be greater than gasnet_AMMaxLongRequest()");
     
-    int neighbour = (gasnet_mynode() == 0 ? 1 : 0);
+    l::reply = opt.reply;
     
     std::vector<gasnet_seginfo_t> seginfo_table(gasnet_nodes());
     gasnet_getSegmentInfo(seginfo_table.data(), seginfo_table.size());
-    auto neighbour_dest_addr = seginfo_table[neighbour].addr;
+    auto neighbour_dest_addr = ( neighbour >= 0 ? seginfo_table[neighbour].addr : nullptr );
     
     l::data = new byte_t[message_size];
 
-#ifdef DO_WARMUP        
-    // warm up
-    l::local_number = ( gasnet_mynode() == 0 ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
-    l::msg_recieved = ( gasnet_mynode() == 0 ? true : false ); // start chain with rank 0
-    
-    BARRIER();
-    for(std::size_t n=0; n<l::N_warmup; ++n)
+    if( opt.warmup > 0 )
     {
-        send_long(l::data, message_size, neighbour, neighbour_dest_addr);
-    }
-    BARRIER();
+        // warm up
+        l::local_number = ( first ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
+        l::msg_recieved = ( first ? true : false ); // start chain with the first rank of the pair
     
-    if( gasnet_mynode() == 0 )
-        GASNET_BLOCKUNTIL( l::local_number == 2*l::N_warmup );
-    else
-        GASNET_BLOCKUNTIL( l::local_number == 2*l::N_warmup -1 );
-#endif
+        BARRIER();
+        for(int n=0; n<opt.warmup && neighbour >= 0; ++n)
+        {
+            send_long(l::data, message_size, neighbour, neighbour_dest_addr);
+        }
+        BARRIER();
+    
+        if( first )
+            GASNET_BLOCKUNTIL( l::local_number == 2*opt.warmup );
+        else if( neighbour >= 0 )
+            GASNET_BLOCKUNTIL( l::local_number == 2*opt.warmup -1 );
+    }
     
     // benchmark
-    l::local_number = ( gasnet_mynode() == 0 ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
-    l::msg_recieved = ( gasnet_mynode() == 0 ? true : false ); // start chain with rank 0
+    l::local_number = ( first ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
+    l::msg_recieved = ( first ? true : false ); // start chain with the first rank of the pair
     
     BARRIER();
-    auto t_0 = std::chrono::high_resolution_clock::now();
+    auto t_0 = bench_clock::now();
+    auto t_last = bench_clock::now();
     
-    for(std::size_t n=0; n<l::N; ++n)
+    for(int n=0; n<opt.round_trips && neighbour >= 0; ++n)
     {
-        send_long(l::data, message_size, neighbour, seginfo_table[neighbour].addr);
+        send_long(l::data, message_size, neighbour, neighbour_dest_addr);
+        
+        // on the first rank every send waits for the previous reply, so two sends are one round trip apart
+        auto t_now = bench_clock::now();
+        if( n > 0 && first ) latencies.record((t_now - t_last) / 2);
+        t_last = t_now;
     }
-
-    BARRIER();
-    auto t_1 = std::chrono::high_resolution_clock::now();
     
-    if( gasnet_mynode() == 0 )
-        GASNET_BLOCKUNTIL( l::local_number == 2*l::N );
-    else
-        GASNET_BLOCKUNTIL( l::local_number == 2*l::N -1 );
+    // the time of this pair ends with the last reply to its first rank, whatever the other pairs do
+    if( first )
+        GASNET_BLOCKUNTIL( l::local_number == 2*opt.round_trips );
+    else if( neighbour >= 0 )
+        GASNET_BLOCKUNTIL( l::local_number == 2*opt.round_trips -1 );
+    
+    auto t_1 = bench_clock::now();
+    BARRIER();
     
     delete[] l::data;
     
-    return std::chrono::duration<double>(t_1 - t_0).count() / (2 * l::N);
+    return std::chrono::duration<double>(t_1 - t_0).count() / (2 * opt.round_trips);
 }
 
 #endif
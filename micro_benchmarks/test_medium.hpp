@@ -11,6 +11,10 @@
 
 #include <gasnet.h>
 
+#include "options.hpp"
+#include "histogram.hpp"
+#include "timer.hpp"
+
 #ifndef BARRIER
 #define BARRIER()                                           \
 do {                                                        \
@@ -24,8 +28,7 @@ typedef char byte_t;
 // global data for medium message
 namespace m
 {
-    const int N = 500;
-    const int N_warmup = 50;
+    bool reply = false;
     
     byte_t *data;
     int reply_number = 0;
@@ -45,12 +48,11 @@ void medium_request_handler(gasnet_token_t token, void *buf, size_t size, int re
     m::msg_recieved = true;   
     m::local_number = recv_number;
     
-#ifdef DO_REPLY
-    gasnet_AMReplyShort0(token, medium_rep_id);
-#endif
+    if( m::reply )
+        gasnet_AMReplyShort0(token, medium_rep_id);
 }
 
-void medium_reply_handler(gasnet_token_t token)
+void medium_reply_handler(gasnet_token_t)
 {
     m::reply_number++;
 }
@@ -64,56 +66,64 @@ void send_medium(byte_t *data, std::size_t size, int dest)
 }
 
 
-double benchmark_medium(int message_size)
+double benchmark_medium(int message_size, int neighbour, bool first, const pingpong_options_t &opt, latency_histogram &latencies)
 {    
     if( message_size > gasnet_AMMaxMedium() )
         throw std::runtime_error("message_size for medium must not be greater than gasnet_AMMaxMedium()");
     
-    int neighbour = (gasnet_mynode() == 0 ? 1 : 0);
+    m::reply = opt.reply;
     
     m::data = new byte_t[message_size];
 
-#ifdef DO_WARMUP        
-    // warm up
-    m::local_number = ( gasnet_mynode() == 0 ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
-    m::msg_recieved = ( gasnet_mynode() == 0 ? true : false ); // start chain with rank 0
-    
-    BARRIER();
-    for(std::size_t n=0; n<m::N_warmup; ++n)
+    if( opt.warmup > 0 )
     {
-        send_medium(m::data, message_size, neighbour);
-    }
-    BARRIER();
+        // warm up
+        m::local_number = ( first ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
+        m::msg_recieved = ( first ? true : false ); // start chain with the first rank of the pair
     
-    if( gasnet_mynode() == 0 )
-        GASNET_BLOCKUNTIL( m::local_number == 2*m::N_warmup );
-    else
-        GASNET_BLOCKUNTIL( m::local_number == 2*m::N_warmup -1 );
-#endif
+        BARRIER();
+        for(int n=0; n<opt.warmup && neighbour >= 0; ++n)
+        {
+            send_medium(m::data, message_size, neighbour);
+        }
+        BARRIER();
+    
+        if( first )
+            GASNET_BLOCKUNTIL( m::local_number == 2*opt.warmup );
+        else if( neighbour >= 0 )
+            GASNET_BLOCKUNTIL( m::local_number == 2*opt.warmup -1 );
+    }
     
     // benchmark
-    m::local_number = ( gasnet_mynode() == 0 ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
-    m::msg_recieved = ( gasnet_mynode() == 0 ? true : false ); // start chain with rank 0
+    m::local_number = ( first ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
+    m::msg_recieved = ( first ? true : false ); // start chain with the first rank of the pair
     
     BARRIER();
-    auto t_0 = std::chrono::high_resolution_clock::now();
+    auto t_0 = bench_clock::now();
+    auto t_last = bench_clock::now();
     
-    for(std::size_t n=0; n<m::N; ++n)
+    for(int n=0; n<opt.round_trips && neighbour >= 0; ++n)
     {
         send_medium(m::data, message_size, neighbour);
+        
+        // on the first rank every send waits for the previous reply, so two sends are one round trip apart
+        auto t_now = bench_clock::now();
+        if( n > 0 && first ) latencies.record((t_now - t_last) / 2);
+        t_last = t_now;
     }
-
-    BARRIER();
-    auto t_1 = std::chrono::high_resolution_clock::now();
     
-    if( gasnet_mynode() == 0 )
-        GASNET_BLOCKUNTIL( m::local_number == 2*m::N );
-    else
-        GASNET_BLOCKUNTIL( m::local_number == 2*m::N -1 );
+    // the time of this pair ends with the last reply to its first rank, whatever the other pairs do
+    if( first )
+        GASNET_BLOCKUNTIL( m::local_number == 2*opt.round_trips );
+    else if( neighbour >= 0 )
+        GASNET_BLOCKUNTIL( m::local_number == 2*opt.round_trips -1 );
+    
+    auto t_1 = bench_clock::now();
+    BARRIER();
     
     delete[] m::data;
     
-    return std::chrono::duration<double>(t_1 - t_0).count() / (2 * m::N);
+    return std::chrono::duration<double>(t_1 - t_0).count() / (2 * opt.round_trips);
 }
 
 #endif
@@ -0,0 +1,111 @@
+#ifndef TEST_PUTGET_HPP
+#define TEST_PUTGET_HPP
+
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+#include <iostream>
+
+#include <gasnet.h>
+
+#include "options.hpp"
+#include "histogram.hpp"
+#include "timer.hpp"
+
+#ifndef BARRIER
+#define BARRIER()                                           \
+do {                                                        \
+  gasnet_barrier_notify(0,GASNET_BARRIERFLAG_ANONYMOUS);    \
+  gasnet_barrier_wait(0,GASNET_BARRIERFLAG_ANONYMOUS);      \
+} while (0)
+#endif
+
+typedef char byte_t;
+
+enum class onesided_op_t { put, get };
+enum class onesided_sync_t { blocking, nb, nbi };
+
+/*
+ * n puts or gets of message_size bytes between a local buffer, in the own segment or on the
+ * heap, and the start of the neighbour's segment. only the first rank of a pair issues them.
+ * blocking operations complete one after the other and each of them is recorded in latencies,
+ * nb and nbi operations are all issued before waiting for them, so their time is the pipelined
+ * throughput. returns the time per operation.
+ */
+double benchmark_onesided(onesided_op_t op, onesided_sync_t sync, bool in_segment, int message_size, int neighbour, bool first,
+                          const pingpong_options_t &opt, latency_histogram &latencies)
+{
+    std::vector<gasnet_seginfo_t> seginfo_table(gasnet_nodes());
+    gasnet_getSegmentInfo(seginfo_table.data(), seginfo_table.size());
+
+    if( static_cast<std::size_t>(message_size) > seginfo_table[gasnet_mynode()].size )
+        throw std::runtime_error("message_size for put/get must not be greater than the segment");
+
+    std::vector<byte_t> heap(in_segment ? 0 : message_size);
+    auto local = ( in_segment ? static_cast<byte_t *>(seginfo_table[gasnet_mynode()].addr) : heap.data() );
+    auto remote = ( neighbour >= 0 ? seginfo_table[neighbour].addr : nullptr );
+
+    auto run = [&](int n, bool record)
+    {
+        if( !first )
+            return;
+
+        std::vector<gasnet_handle_t> handles;
+        auto t_last = bench_clock::now();
+
+        for(int i=0; i<n; ++i)
+        {
+            if( sync == onesided_sync_t::blocking )
+            {
+                if( op == onesided_op_t::put )
+                    gasnet_put_bulk(neighbour, remote, local, message_size);
+                else
+                    gasnet_get_bulk(local, neighbour, remote, message_size);
+
+                auto t_now = bench_clock::now();
+                if( record ) latencies.record(t_now - t_last);
+                t_last = t_now;
+            }
+            else if( sync == onesided_sync_t::nb )
+            {
+                if( op == onesided_op_t::put )
+                    handles.push_back( gasnet_put_nb_bulk(neighbour, remote, local, message_size) );
+                else
+                    handles.push_back( gasnet_get_nb_bulk(local, neighbour, remote, message_size) );
+            }
+            else
+            {
+                if( op == onesided_op_t::put )
+                    gasnet_put_nbi_bulk(neighbour, remote, local, message_size);
+                else
+                    gasnet_get_nbi_bulk(local, neighbour, remote, message_size);
+            }
+        }
+
+        if( sync == onesided_sync_t::nb )
+            gasnet_wait_syncnb_all(handles.data(), handles.size());
+        else if( sync == onesided_sync_t::nbi )
+            gasnet_wait_syncnbi_all();
+    };
+
+    if( opt.warmup > 0 )
+    {
+        // warm up
+        BARRIER();
+        run(opt.warmup, false);
+        BARRIER();
+    }
+
+    // benchmark
+    BARRIER();
+    auto t_0 = bench_clock::now();
+
+    run(opt.round_trips, true);
+
+    auto t_1 = bench_clock::now();
+    BARRIER();
+
+    return std::chrono::duration<double>(t_1 - t_0).count() / opt.round_trips;
+}
+
+#endif
@@ -8,7 +8,10 @@
 
 #include <gasnet.h>
 
+#include "options.hpp"
+#include "histogram.hpp"
 #include "mcl.hpp"
+#include "timer.hpp"
 
 #ifndef BARRIER
 #define BARRIER()                                           \
@@ -20,8 +23,7 @@ do {                                                        \
 
 namespace s
 {
-    const int N = 500;
-    const int N_warmup = 0;
+    bool reply = false;
     
     std::atomic<int> local_number{ 0 };
     std::atomic<int> reply_number{ 0 };
@@ -39,12 +41,11 @@ void short_request_handler(gasnet_token_t token, gasnet_handlerarg_t recv_number
     s::local_number = recv_number;
     s::msg_received = true;
     
-#ifdef DO_REPLY
-    gasnet_AMReplyShort0(token, short_rep_id);
-#endif
+    if( s::reply )
+        gasnet_AMReplyShort0(token, short_rep_id);
 }
 
-void short_reply_handler(gasnet_token_t token)
+void short_reply_handler(gasnet_token_t)
 {
     s::reply_number++;
 }
@@ -56,49 +57,57 @@ void send_short(int dest)
     gasnet_AMRequestShort1(dest, short_req_id, s::local_number+1);
 } 
 
-double benchmark_short()
+double benchmark_short(int neighbour, bool first, const pingpong_options_t &opt, latency_histogram &latencies)
 {
-    int neighbour = (gasnet_mynode() == 0 ? 1 : 0);
-    
-#ifdef DO_WARMUP 
-    // warm up
-    s::local_number = ( gasnet_mynode() == 0 ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
-    s::msg_received = ( gasnet_mynode() == 0 ? true : false ); // start chain with rank 0
+    s::reply = opt.reply;
     
-    BARRIER();
-    for(std::size_t n=0; n<s::N_warmup; ++n)
+    if( opt.warmup > 0 )
     {
-        send_short(neighbour);
-    }
-    BARRIER();
+        // warm up
+        s::local_number = ( first ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
+        s::msg_received = ( first ? true : false ); // start chain with the first rank of the pair
     
-    if( gasnet_mynode() == 0 )
-        GASNET_BLOCKUNTIL( s::local_number == 2*s::N_warmup );
-    else
-        GASNET_BLOCKUNTIL( s::local_number == 2*s::N_warmup -1 );
-#endif
+        BARRIER();
+        for(int n=0; n<opt.warmup && neighbour >= 0; ++n)
+        {
+            send_short(neighbour);
+        }
+        BARRIER();
+    
+        if( first )
+            GASNET_BLOCKUNTIL( s::local_number == 2*opt.warmup );
+        else if( neighbour >= 0 )
+            GASNET_BLOCKUNTIL( s::local_number == 2*opt.warmup -1 );
+    }
     
     // benchmark
-    s::local_number = ( gasnet_mynode() == 0 ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
-    s::msg_received = ( gasnet_mynode() == 0 ? true : false ); // start chain with rank 0
+    s::local_number = ( first ? 0 : -1 ); // start #1 with -1 since difference after each ping-pong should be 2
+    s::msg_received = ( first ? true : false ); // start chain with the first rank of the pair
     
     BARRIER();
-    auto t_0 = std::chrono::high_resolution_clock::now();
-        
-    for(std::size_t n=0; n<s::N; ++n)
+    auto t_0 = bench_clock::now();
+    auto t_last = bench_clock::now();
+    
+    for(int n=0; n<opt.round_trips && neighbour >= 0; ++n)
     {
         send_short(neighbour);
-    }
         
-    BARRIER();
-    auto t_1 = std::chrono::high_resolution_clock::now();
+        // on the first rank every send waits for the previous reply, so two sends are one round trip apart
+        auto t_now = bench_clock::now();
+        if( n > 0 && first ) latencies.record((t_now - t_last) / 2);
+        t_last = t_now;
+    }
     
-    if( gasnet_mynode() == 0 )
-        GASNET_BLOCKUNTIL( s::local_number == 2*s::N );
-    else
-        GASNET_BLOCKUNTIL( s::local_number == 2*s::N -1 );
+    // the time of this pair ends with the last reply to its first rank, whatever the other pairs do
+    if( first )
+        GASNET_BLOCKUNTIL( s::local_number == 2*opt.round_trips );
+    else if( neighbour >= 0 )
+        GASNET_BLOCKUNTIL( s::local_number == 2*opt.round_trips -1 );
+    
+    auto t_1 = bench_clock::now();
+    BARRIER();
     
-    return std::chrono::duration<double>(t_1 - t_0).count() / (2 * s::N);
+    return std::chrono::duration<double>(t_1 - t_0).count() / (2 * opt.round_trips);
 }
 
 #endif
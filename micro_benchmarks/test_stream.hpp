@@ -0,0 +1,153 @@
+#ifndef TEST_STREAM_HPP
+#define TEST_STREAM_HPP
+
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <stdexcept>
+#include <iostream>
+#include <atomic>
+#include <algorithm>
+
+#include <gasnet.h>
+
+#include "timer.hpp"
+
+#ifndef BARRIER
+#define BARRIER()                                           \
+do {                                                        \
+  gasnet_barrier_notify(0,GASNET_BARRIERFLAG_ANONYMOUS);    \
+  gasnet_barrier_wait(0,GASNET_BARRIERFLAG_ANONYMOUS);      \
+} while (0)
+#endif
+
+typedef char byte_t;
+
+// global data for streaming
+namespace st
+{
+    std::atomic<long> arrived{ 0 };
+    std::atomic<long> acked{ 0 };
+}
+
+const gasnet_handler_t stream_short_id  = 206;
+const gasnet_handler_t stream_medium_id = 207;
+const gasnet_handler_t stream_long_id   = 208;
+const gasnet_handler_t stream_ack_id    = 209;
+
+// every arrival is acknowledged, the acknowledgements drive the sender's window
+void stream_short_handler(gasnet_token_t token)
+{
+    st::arrived++;
+    gasnet_AMReplyShort0(token, stream_ack_id);
+}
+
+void stream_medium_handler(gasnet_token_t token, void *, size_t)
+{
+    st::arrived++;
+    gasnet_AMReplyShort0(token, stream_ack_id);
+}
+
+void stream_long_handler(gasnet_token_t token, void *, size_t)
+{
+    st::arrived++;
+    gasnet_AMReplyShort0(token, stream_ack_id);
+}
+
+void stream_ack_handler(gasnet_token_t)
+{
+    st::acked++;
+}
+
+enum class stream_kind_t { short_am, medium_am, long_am, put };
+
+// largest payload of a kind, long and put land at the start of the peer's segment
+std::size_t stream_max_size(stream_kind_t kind, std::size_t segment_size)
+{
+    switch( kind )
+    {
+        case stream_kind_t::short_am:  return 0;
+        case stream_kind_t::medium_am: return gasnet_AMMaxMedium();
+        case stream_kind_t::long_am:   return std::min(segment_size, gasnet_AMMaxLongRequest());
+        default:                       return segment_size;
+    }
+}
+
+/*
+ * sends n messages of size bytes to peer, with at most window of them unacknowledged
+ * (puts: not completed), and/or receives n messages from peer. returns the time from the
+ * first send until the last completion on a sending rank, until the last arrival otherwise;
+ * receive_time gets the time until the last arrival on its own, so a rank that does both
+ * can tell its sends from the peer's. puts are not seen by the receiver, so only the
+ * sender's time is meaningful for them (receive_time stays 0).
+ */
+double benchmark_stream(stream_kind_t kind, std::size_t size, int window, int n, int peer, bool send, bool receive, double *receive_time = nullptr)
+{
+    if( kind == stream_kind_t::medium_am && size > gasnet_AMMaxMedium() )
+        throw std::runtime_error("message_size for medium must not be greater than gasnet_AMMaxMedium()");
+
+    std::vector<gasnet_seginfo_t> seginfo_table(gasnet_nodes());
+    gasnet_getSegmentInfo(seginfo_table.data(), seginfo_table.size());
+    auto peer_dest_addr = seginfo_table[peer].addr;
+
+    std::vector<byte_t> data(std::max<std::size_t>(size, 1));
+    std::deque<gasnet_handle_t> handles;
+
+    st::arrived = 0;
+    st::acked = 0;
+
+    BARRIER();
+    auto t_0 = bench_clock::now();
+    auto t_sent = t_0;
+    auto t_received = t_0;
+
+    if( send )
+    {
+        for(int i=0; i<n; ++i)
+        {
+            if( kind == stream_kind_t::put )
+            {
+                if( handles.size() == static_cast<std::size_t>(window) )
+                {
+                    gasnet_wait_syncnb(handles.front());
+                    handles.pop_front();
+                }
+
+                handles.push_back( gasnet_put_nb_bulk(peer, peer_dest_addr, data.data(), size) );
+                continue;
+            }
+
+            GASNET_BLOCKUNTIL( i - st::acked < window );
+
+            if( kind == stream_kind_t::short_am )
+                gasnet_AMRequestShort0(peer, stream_short_id);
+            else if( kind == stream_kind_t::medium_am )
+                gasnet_AMRequestMedium0(peer, stream_medium_id, data.data(), size);
+            else
+                gasnet_AMRequestLong0(peer, stream_long_id, data.data(), size, peer_dest_addr);
+        }
+
+        for(auto h : handles)
+            gasnet_wait_syncnb(h);
+
+        if( kind != stream_kind_t::put )
+            GASNET_BLOCKUNTIL( st::acked == n );
+
+        t_sent = bench_clock::now();
+    }
+
+    if( receive && kind != stream_kind_t::put )
+    {
+        GASNET_BLOCKUNTIL( st::arrived == n );
+        t_received = bench_clock::now();
+    }
+
+    BARRIER();
+
+    if( receive_time )
+        *receive_time = std::chrono::duration<double>(t_received - t_0).count();
+
+    return std::chrono::duration<double>((send ? t_sent : t_received) - t_0).count();
+}
+
+#endif
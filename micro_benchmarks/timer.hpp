@@ -0,0 +1,53 @@
+#ifndef TIMER_HPP
+#define TIMER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <sstream>
+#include <iomanip>
+
+#include "../include/timer.h"
+
+/*
+ * the calibrated clock of include/timer.h as a std::chrono clock, in place of
+ * high_resolution_clock, steady_clock and MPI_Wtime:
+ *
+ *   auto t_0 = bench_clock::now();
+ *   ...
+ *   double seconds = std::chrono::duration<double>(bench_clock::now() - t_0).count();
+ */
+struct bench_clock
+{
+    typedef std::chrono::nanoseconds duration;
+    typedef duration::rep rep;
+    typedef duration::period period;
+    typedef std::chrono::time_point<bench_clock> time_point;
+
+    static const bool is_steady = true;
+
+    static time_point now()
+    {
+        return time_point(duration(static_cast<rep>(timer_seconds() * 1.0e9)));
+    }
+};
+
+// for the header of the benchmark output, e.g. "rdtsc, overhead 8.2 ns, resolution 7.5 ns"
+inline std::string timer_description()
+{
+    timer_init();
+
+    std::stringstream stream;
+    stream << std::fixed << std::setprecision(1) << timer_name() << ", overhead " << timer_state.overhead*1.0e9
+           << " ns, resolution " << timer_state.resolution*1.0e9 << " ns";
+
+    return stream.str();
+}
+
+// calibrate before main, so no measurement pays for it
+namespace ti
+{
+    static const bool timer_ready = (timer_init(), true);
+}
+
+#endif
@@ -0,0 +1,132 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+
+#include "my_mpi.hpp"
+#include "task_pool.hpp"
+#include "mcl.hpp"
+#include "collect_my_mpi.hpp"
+#include "timer.hpp"
+
+/*
+ * unbalanced tree search (UTS) style binomial tree: the root has root_children children,
+ * every other node has m children with probability q. with q*m < 1 the tree is finite,
+ * but the subtree sizes vary wildly, so a static split over the ranks is badly balanced.
+ */
+const int root_children = 2000;
+const int m = 8;
+const double q = 0.124;
+
+task_pool *g_pool;
+std::uint64_t g_nodes_visited = 0;
+
+std::uint64_t splitmix64(std::uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+void visit(std::uint64_t node)
+{
+    g_nodes_visited++;
+
+    auto hash = splitmix64(node);
+    bool has_children = static_cast<double>(hash >> 11) / static_cast<double>(1ull << 53) < q;
+
+    if( has_children )
+        for(int i=0; i<m; ++i)
+            g_pool->spawn(&visit, splitmix64(hash + i));
+}
+
+double run_uts(my_mpi &mpi, task_pool &pool, bool steal)
+{
+    g_nodes_visited = 0;
+
+    // static split of the root's children
+    if( mpi.rank() == 0 ) g_nodes_visited++;
+
+    for(int i=mpi.rank(); i<root_children; i+=mpi.world_size())
+        pool.spawn(&visit, splitmix64(i));
+
+    auto t_0 = bench_clock::now();
+    pool.run(steal);
+    auto t_1 = bench_clock::now();
+
+    return std::chrono::duration<double>(t_1 - t_0).count();
+}
+
+int main()
+{
+    my_mpi mpi;
+    task_pool pool(mpi);
+    g_pool = &pool;
+
+    const int rank = mpi.rank();
+    const int ranks = mpi.world_size();
+
+    auto metadata = my_mpi_metadata(mpi, "my_mpi_uts", my_mpi_config());
+    metadata.set("root_children", root_children);
+    metadata.set("m", m);
+    metadata.set("q", q);
+
+    if( rank == 0 )
+    {
+        std::cout << "UTS BENCHMARK (binomial tree, b0 = " << root_children << ", m = " << m << ", q = " << q << ")" << std::endl;
+        std::cout << "- ranks: " << ranks << std::endl;
+        std::cout << "- timer: " << timer_description() << std::endl;
+    }
+
+    std::vector<std::string> modes = { "static", "stealing" };
+    std::vector<double> times;
+    std::vector<double> rates;
+    std::vector<double> imbalances;
+
+    for(bool steal : { false, true })
+    {
+        auto time = run_uts(mpi, pool, steal);
+
+        std::vector<std::uint64_t> total = { g_nodes_visited };
+        std::vector<std::uint64_t> most = { g_nodes_visited };
+        std::vector<double> slowest = { time };
+
+        mpi.allreduce(total, std::plus<std::uint64_t>());
+        mpi.allreduce(most, [](std::uint64_t a, std::uint64_t b){ return std::max(a, b); });
+        mpi.allreduce(slowest, [](double a, double b){ return std::max(a, b); });
+
+        times.push_back(slowest.front());
+        rates.push_back(total.front() / slowest.front());
+
+        // 1.0 means every rank visited the same number of nodes
+        imbalances.push_back(static_cast<double>(most.front()) * ranks / total.front());
+
+        if( rank == 0 )
+            std::cout << "- " << (steal ? "stealing" : "static  ") << ": nodes = " << total.front() << std::endl;
+    }
+
+    std::uint64_t steals_attempted = pool.steals_attempted();
+    std::uint64_t steals_succeeded = pool.steals_succeeded();
+
+    if( rank == 0 )
+    {
+        std::cout << std::fixed;
+        std::cout << "RESULTS:" << std::endl;
+
+        for(std::size_t i=0; i<modes.size(); ++i)
+        {
+            std::cout << "- " << modes[i] << ": time = " << times[i]*1.0e3 << " ms, rate = " << rates[i]/1.0e6
+                      << " Mnodes/s, max/avg work = " << imbalances[i] << std::endl;
+        }
+
+        std::cout << "- rank 0 steals: " << steals_succeeded << " of " << steals_attempted << " successful" << std::endl;
+
+        write_results("my_mpi_uts", metadata, {"time", "rate", "imbalance"}, times, rates, imbalances);
+    }
+
+    mpi.barrier();
+}
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <ctime>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "my_mpi.hpp"
+#include "mcl.hpp"
+#include "collect_my_mpi.hpp"
+#include "timer.hpp"
+
+/*
+ * latency against CPU consumption of the wait policies: rank 0 ping-pongs with rank 1,
+ * once with immediate replies and once with rank 1 "computing" for delay_us before it
+ * replies. in the second case rank 0 spends nearly all its time waiting in recv_data.
+ */
+const int iterations = 1000;
+const int N_warmup = 100;
+
+my_mpi_wait_policy parse_policy(const std::string &name)
+{
+    if( name == "spin" )  return my_mpi_wait_policy::spin;
+    if( name == "yield" ) return my_mpi_wait_policy::spin_yield;
+    if( name == "sleep" ) return my_mpi_wait_policy::spin_sleep;
+
+    throw std::runtime_error("unknown wait policy " + name + " (spin, yield or sleep)");
+}
+
+// returns the round trip time and the CPU time rank 0 used per round trip
+void pingpong(my_mpi &mpi, int n, int delay_us, double &round_trip, double &cpu)
+{
+    std::vector<long> msg = { 0 };
+
+    mpi.barrier();
+
+    auto t_0 = bench_clock::now();
+    auto c_0 = std::clock();
+
+    for(int i=0; i<n; ++i)
+    {
+        if( mpi.rank() == 0 )
+        {
+            mpi.send_data(1, 0, msg);
+            msg = mpi.recv_data<long>(1);
+        }
+        else if( mpi.rank() == 1 )
+        {
+            msg = mpi.recv_data<long>(0);
+
+            if( delay_us > 0 )
+                std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+
+            mpi.send_data(0, 1, msg);
+        }
+    }
+
+    auto c_1 = std::clock();
+    auto t_1 = bench_clock::now();
+
+    round_trip = std::chrono::duration<double>(t_1 - t_0).count() / n;
+    cpu = static_cast<double>(c_1 - c_0) / CLOCKS_PER_SEC / n;
+}
+
+int main(int argc, char ** argv)
+{
+    my_mpi_config config;
+
+    std::string policy = "spin";
+    int delay_us = 1000;
+
+    if(argc >= 2) policy = argv[1];
+    if(argc >= 3) config.wait_spins = std::atol(argv[2]);
+    if(argc >= 4) delay_us = std::atoi(argv[3]);
+
+    config.wait_policy = parse_policy(policy);
+
+    my_mpi mpi(config);
+
+    if( mpi.world_size() < 2 )
+        throw std::runtime_error("the wait benchmark needs at least 2 ranks");
+
+    auto metadata = my_mpi_metadata(mpi, "my_mpi_wait", config);
+    metadata.set("policy", policy);
+    metadata.set("wait_spins", config.wait_spins);
+    metadata.set("delay_us", delay_us);
+
+    if( mpi.rank() == 0 )
+    {
+        std::cout << "WAIT POLICY BENCHMARK" << std::endl;
+        std::cout << "- policy: " << policy << ", spins before backing off: " << config.wait_spins
+                  << ", reply delay: " << delay_us << " us" << std::endl;
+        std::cout << "- timer: " << timer_description() << std::endl;
+    }
+
+    double round_trip, cpu, delayed_round_trip, delayed_cpu;
+
+    pingpong(mpi, N_warmup, 0, round_trip, cpu);
+    pingpong(mpi, iterations, 0, round_trip, cpu);
+    pingpong(mpi, iterations / 10, delay_us, delayed_round_trip, delayed_cpu);
+
+    // share of the waiting time rank 0 kept a core busy
+    const double utilisation = delayed_cpu / delayed_round_trip;
+
+    // latency the policy adds on top of the delay
+    const double wake_up = delayed_round_trip - delay_us*1.0e-6 - round_trip;
+
+    std::vector<double> latencies = { round_trip / 2 };
+    std::vector<double> wake_ups = { wake_up };
+    std::vector<double> utilisations = { utilisation };
+
+    if( mpi.rank() == 0 )
+    {
+        std::cout << std::fixed;
+        std::cout << "RESULTS:" << std::endl;
+        std::cout << "- latency = " << round_trip / 2 * 1.0e6 << " us" << std::endl;
+        std::cout << "- delayed reply: wake-up overhead = " << wake_up * 1.0e6 << " us, CPU while waiting = "
+                  << utilisation * 100 << " %" << std::endl;
+
+        write_results("my_mpi_wait_" + policy, metadata, {"latency", "wake_up", "cpu"}, latencies, wake_ups, utilisations);
+    }
+
+    mpi.barrier();
+}
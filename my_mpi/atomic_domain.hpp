@@ -0,0 +1,90 @@
+/*
+ * remote atomic operations on segment memory
+ */
+
+#ifndef ATOMIC_DOMAIN_H
+#define ATOMIC_DOMAIN_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "my_mpi.hpp"
+#include "my_future.hpp"
+#include "global_ptr.hpp"
+
+/*
+ * ranks sharing memory with the target (and the target itself) use CPU atomics directly,
+ * all others send one AM which the owner applies with CPU atomics in the handler.
+ * all accesses to a word must go through an atomic_domain while others may modify it.
+ */
+template<typename T>
+class atomic_domain
+{
+    static_assert( std::is_integral<T>::value && (sizeof(T) == 4 || sizeof(T) == 8), "atomics need a 32 or 64 bit integer type" );
+
+public:
+    atomic_domain(my_mpi &mpi) : m_mpi(mpi) {}
+
+    my_future<T> load(global_ptr<T> p) { return op(my_mpi_atomic_op::load, p, 0); }
+    my_future<void> store(global_ptr<T> p, T value) { return discard(op(my_mpi_atomic_op::store, p, value)); }
+
+    my_future<T> exchange(global_ptr<T> p, T value) { return op(my_mpi_atomic_op::exchange, p, value); }
+    my_future<T> fetch_add(global_ptr<T> p, T value) { return op(my_mpi_atomic_op::fetch_add, p, value); }
+    my_future<T> fetch_sub(global_ptr<T> p, T value) { return op(my_mpi_atomic_op::fetch_add, p, static_cast<T>(-value)); }
+    my_future<T> fetch_and(global_ptr<T> p, T value) { return op(my_mpi_atomic_op::fetch_and, p, value); }
+    my_future<T> fetch_or(global_ptr<T> p, T value)  { return op(my_mpi_atomic_op::fetch_or, p, value); }
+    my_future<T> fetch_xor(global_ptr<T> p, T value) { return op(my_mpi_atomic_op::fetch_xor, p, value); }
+
+    // returns the old value, desired was written if it equals expected
+    my_future<T> compare_exchange(global_ptr<T> p, T expected, T desired)
+    {
+        return op(my_mpi_atomic_op::compare_exchange, p, desired, expected);
+    }
+
+private:
+    static std::uint64_t to_bits(T value)
+    {
+        std::uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(T));
+        return bits;
+    }
+
+    static T from_bits(std::uint64_t bits)
+    {
+        T value;
+        std::memcpy(&value, &bits, sizeof(T));
+        return value;
+    }
+
+    my_future<T> op(my_mpi_atomic_op kind, global_ptr<T> p, T operand, T compare = 0)
+    {
+        auto raw = m_mpi.atomic(kind, sizeof(T), p.where(), p.offset(), to_bits(operand), to_bits(compare));
+
+        if( raw.ready() )
+            return my_future<T>::make_ready(from_bits(raw.get()));
+
+        my_future<T> future;
+        auto state = future.state().get();
+
+        // a plain pointer, the state owns test and must not be kept alive by it
+        state->test = [state, raw](){ if( !raw.ready() ) return false; state->value = from_bits(raw.get()); return true; };
+
+        return future;
+    }
+
+    static my_future<void> discard(my_future<T> f)
+    {
+        if( f.ready() )
+            return my_future<void>::make_ready();
+
+        my_future<void> future;
+        future.state()->test = [f](){ return f.ready(); };
+
+        return future;
+    }
+
+    my_mpi &m_mpi;
+};
+
+#endif // ATOMIC_DOMAIN_H
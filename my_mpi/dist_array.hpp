@@ -0,0 +1,76 @@
+/*
+ * array distributed over the segments of all ranks
+ */
+
+#ifndef DIST_ARRAY_H
+#define DIST_ARRAY_H
+
+#include <cstddef>
+#include <algorithm>
+
+#include "my_mpi.hpp"
+#include "global_ptr.hpp"
+
+/*
+ * the elements are dealt out in blocks of block_size round robin over the ranks
+ * (block-cyclic). block() gives every rank one contiguous block (block distribution).
+ */
+struct distribution_t
+{
+    static distribution_t block() { return { 0 }; }
+    static distribution_t block_cyclic(std::size_t block_size) { return { block_size }; }
+
+    std::size_t block_size;
+};
+
+template<typename T>
+class dist_array
+{
+public:
+    // collective, all ranks must construct their dist_arrays in the same order
+    dist_array(my_mpi &mpi, std::size_t size, distribution_t dist = distribution_t::block()) :
+        m_mpi(mpi), m_size(size), m_ranks(mpi.world_size())
+    {
+        m_block_size = dist.block_size != 0 ? dist.block_size : std::max<std::size_t>((size + m_ranks - 1) / m_ranks, 1);
+
+        const auto num_blocks = (size + m_block_size - 1) / m_block_size;
+        m_local_capacity = (num_blocks + m_ranks - 1) / m_ranks * m_block_size;
+        m_offset = mpi.segment_alloc(m_local_capacity*sizeof(T));
+        m_local_data = static_cast<T *>(mpi.segment_local(mpi.rank(), m_offset));
+    }
+
+    std::size_t size() const { return m_size; }
+    std::size_t block_size() const { return m_block_size; }
+
+    int owner(std::size_t i) const { return (i / m_block_size) % m_ranks; }
+    std::size_t local_index(std::size_t i) const { return (i / (m_block_size*m_ranks))*m_block_size + i % m_block_size; }
+
+    global_ptr<T> operator[](std::size_t i) const { return { owner(i), m_offset + local_index(i)*sizeof(T) }; }
+
+    // plain pointer if element i lives on this rank or a shm peer, nullptr otherwise
+    T *local(std::size_t i) const { return (*this)[i].local(m_mpi); }
+
+    my_future<T> rget(std::size_t i) const { return ::rget(m_mpi, (*this)[i]); }
+    my_future<void> rput(std::size_t i, const T &value) const { return ::rput(m_mpi, value, (*this)[i]); }
+
+    // storage of this rank, includes padding of the last block
+    T *local_data() const { return m_local_data; }
+    std::size_t local_capacity() const { return m_local_capacity; }
+
+    // global index of the n-th local element (may be >= size() for padding)
+    std::size_t global_index(std::size_t n) const
+    {
+        return (n / m_block_size * m_ranks + m_mpi.rank()) * m_block_size + n % m_block_size;
+    }
+
+private:
+    my_mpi &m_mpi;
+    std::size_t m_size;
+    std::size_t m_ranks;
+    std::size_t m_block_size;
+    std::size_t m_local_capacity;
+    std::size_t m_offset;
+    T *m_local_data;
+};
+
+#endif // DIST_ARRAY_H
@@ -0,0 +1,270 @@
+/*
+ * hash map distributed over all ranks
+ */
+
+#ifndef DIST_HASH_MAP_H
+#define DIST_HASH_MAP_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include <type_traits>
+
+#include "my_mpi.hpp"
+#include "my_future.hpp"
+
+/*
+ * every key is owned by one rank, chosen by its hash. updates and lookups are collected
+ * per owner and sent as one AM per batch, the owner applies them inside the handler.
+ * updates to keys owned by this rank are applied immediately.
+ *
+ * updates are only guaranteed to be visible after flush() on the sending rank (and a
+ * barrier, if other ranks read them). local() must not be iterated while the map is
+ * used by other ranks, since their batches are applied during progress().
+ *
+ * construction and destruction are collective. futures of find() may outlive the map,
+ * they are ready by then.
+ */
+template<typename K, typename V, typename hash_t = std::hash<K>, typename combine_t = std::plus<V>>
+class dist_hash_map
+{
+    static_assert( std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                   "keys and values of a dist_hash_map must be trivially copyable" );
+
+public:
+    struct lookup_t
+    {
+        bool found;
+        V value;
+    };
+
+    // collective, batch_size = 0 sends as many records per AM as fit
+    dist_hash_map(my_mpi &mpi, std::size_t batch_size = 0) :
+        m_mpi(mpi), m_updates(mpi.world_size()), m_lookup_keys(mpi.world_size()), m_lookup_states(mpi.world_size())
+    {
+        const auto max_size = mpi.max_message_size();
+
+        m_update_batch = batch_size != 0 ? std::min(batch_size, max_size / sizeof(update_t)) : max_size / sizeof(update_t);
+        m_lookup_batch = batch_size != 0 ? batch_size : max_size;
+        m_lookup_batch = std::min(m_lookup_batch, max_size / std::max(sizeof(K), sizeof(lookup_t)));
+
+        m_id = mpi.register_object(this);
+        mpi.barrier();
+    }
+
+    // no batch may still be in flight to or from this instance once it is unregistered
+    ~dist_hash_map()
+    {
+        flush();
+        m_mpi.barrier();
+        m_mpi.unregister_object(m_id);
+    }
+
+    dist_hash_map(const dist_hash_map &) = delete;
+    dist_hash_map &operator=(const dist_hash_map &) = delete;
+
+    int owner(const K &key) const
+    {
+        // mix the hash, the local table buckets by the same hash
+        std::uint64_t h = hash_t()(key);
+        h = (h ^ (h >> 33)) * 0xFF51AFD7ED558CCDull;
+        h = (h ^ (h >> 33)) * 0xC4CEB9FE1A85EC53ull;
+        return (h ^ (h >> 33)) % m_mpi.world_size();
+    }
+
+    // replaces the value
+    void insert(const K &key, const V &value) { add(key, value, false); }
+
+    // combines the value with the present one, inserts it if the key is new
+    void update(const K &key, const V &value) { add(key, value, true); }
+
+    my_future<lookup_t> find(const K &key)
+    {
+        const int dest = owner(key);
+
+        if( dest == m_mpi.rank() )
+            return my_future<lookup_t>::make_ready(lookup_local(key));
+
+        my_future<lookup_t> future;
+
+        m_lookup_keys[dest].push_back(key);
+        m_lookup_states[dest].push_back(future.state());
+
+        if( m_lookup_keys[dest].size() >= m_lookup_batch )
+            send_lookups(dest);
+
+        // waiting on a lookup sends its batch, the reply marks the state ready during a later progress()
+        std::weak_ptr<dist_hash_map *> self = m_self;
+        future.state()->test = [self, dest]()
+        {
+            auto map = self.lock();
+
+            if( map && !(*map)->m_lookup_keys[dest].empty() )
+                (*map)->send_lookups(dest);
+
+            return false;
+        };
+
+        return future;
+    }
+
+    // sends all batches and waits until the owners have applied them
+    void flush()
+    {
+        for(int dest=0; dest<m_mpi.world_size(); ++dest)
+        {
+            if( !m_updates[dest].empty() ) send_updates(dest);
+            if( !m_lookup_keys[dest].empty() ) send_lookups(dest);
+        }
+
+        std::size_t polls = 0;
+
+        while( m_pending != 0 )
+        {
+            m_mpi.progress();
+            my_mpi_backoff(polls);
+        }
+    }
+
+    std::unordered_map<K, V, hash_t> &local() { return m_local; }
+
+private:
+    struct update_t
+    {
+        K key;
+        V value;
+        bool combine;
+    };
+
+    void apply(const update_t &u)
+    {
+        if( !u.combine )
+        {
+            m_local[u.key] = u.value;
+            return;
+        }
+
+        auto found = m_local.find(u.key);
+
+        if( found == m_local.end() )
+            m_local.emplace(u.key, u.value);
+        else
+            found->second = combine_t()(found->second, u.value);
+    }
+
+    lookup_t lookup_local(const K &key)
+    {
+        auto found = m_local.find(key);
+
+        if( found == m_local.end() )
+            return { false, V() };
+
+        return { true, found->second };
+    }
+
+    void add(const K &key, const V &value, bool combine)
+    {
+        const int dest = owner(key);
+
+        if( dest == m_mpi.rank() )
+        {
+            apply({ key, value, combine });
+            return;
+        }
+
+        m_updates[dest].push_back({ key, value, combine });
+
+        if( m_updates[dest].size() >= m_update_batch )
+            send_updates(dest);
+    }
+
+    static void apply_updates(void *object, const char *buf, std::size_t size, std::vector<char> &reply)
+    {
+        auto self = static_cast<dist_hash_map *>(object);
+
+        for(std::size_t pos = 0; pos < size; pos += sizeof(update_t))
+        {
+            update_t u;
+            std::memcpy(&u, buf + pos, sizeof(u));
+            self->apply(u);
+        }
+
+        reply.clear();
+    }
+
+    static void apply_lookups(void *object, const char *buf, std::size_t size, std::vector<char> &reply)
+    {
+        auto self = static_cast<dist_hash_map *>(object);
+
+        reply.resize(size / sizeof(K) * sizeof(lookup_t));
+
+        for(std::size_t i = 0; i < size / sizeof(K); ++i)
+        {
+            K key;
+            std::memcpy(&key, buf + i*sizeof(K), sizeof(K));
+
+            auto result = self->lookup_local(key);
+            std::memcpy(reply.data() + i*sizeof(lookup_t), &result, sizeof(lookup_t));
+        }
+    }
+
+    void send_updates(int dest)
+    {
+        m_pending++;
+
+        // the destructor waits for all replies, the weak pointer only guards against misuse
+        std::weak_ptr<dist_hash_map *> self = m_self;
+
+        m_mpi.call_object(dest, &apply_updates, m_id, reinterpret_cast<const char *>(m_updates[dest].data()),
+                          m_updates[dest].size()*sizeof(update_t), [self](const char *, std::size_t)
+        {
+            if( auto map = self.lock() ) (*map)->m_pending--;
+        });
+
+        m_updates[dest].clear();
+    }
+
+    void send_lookups(int dest)
+    {
+        // moved out first, the batch may be refilled before the reply arrives
+        auto states = std::make_shared<std::vector<std::shared_ptr<typename my_future<lookup_t>::state_t>>>();
+        states->swap(m_lookup_states[dest]);
+
+        m_pending++;
+
+        std::weak_ptr<dist_hash_map *> self = m_self;
+
+        m_mpi.call_object(dest, &apply_lookups, m_id, reinterpret_cast<const char *>(m_lookup_keys[dest].data()),
+                          m_lookup_keys[dest].size()*sizeof(K), [self, states](const char *buf, std::size_t)
+        {
+            for(std::size_t i=0; i<states->size(); ++i)
+            {
+                std::memcpy(&(*states)[i]->value, buf + i*sizeof(lookup_t), sizeof(lookup_t));
+                (*states)[i]->ready = true;
+            }
+
+            if( auto map = self.lock() ) (*map)->m_pending--;
+        });
+
+        m_lookup_keys[dest].clear();
+    }
+
+    my_mpi &m_mpi;
+    int m_id;
+
+    // expires with the map, for callbacks that may be called after it is gone
+    std::shared_ptr<dist_hash_map *> m_self{ std::make_shared<dist_hash_map *>(this) };
+    std::size_t m_update_batch;
+    std::size_t m_lookup_batch;
+    std::size_t m_pending{ 0 };
+
+    std::unordered_map<K, V, hash_t> m_local;
+    std::vector<std::vector<update_t>> m_updates;
+    std::vector<std::vector<K>> m_lookup_keys;
+    std::vector<std::vector<std::shared_ptr<typename my_future<lookup_t>::state_t>>> m_lookup_states;
+};
+
+#endif // DIST_HASH_MAP_H
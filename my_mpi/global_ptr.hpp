@@ -0,0 +1,94 @@
+/*
+ * pointer into the GASNet segment of any rank
+ */
+
+#ifndef GLOBAL_PTR_H
+#define GLOBAL_PTR_H
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+#include "my_mpi.hpp"
+#include "my_future.hpp"
+
+template<typename T>
+class global_ptr
+{
+    static_assert( std::is_trivially_copyable<T>::value, "global_ptr needs a trivially copyable type" );
+
+public:
+    global_ptr() = default;
+    global_ptr(int node, std::size_t offset) : m_node(node), m_offset(offset) {}
+
+    int where() const { return m_node; }
+    std::size_t offset() const { return m_offset; }
+    bool is_null() const { return m_node < 0; }
+
+    // plain pointer if the element lives on this rank or a shm peer, nullptr otherwise
+    T *local(my_mpi &mpi) const { return static_cast<T *>(mpi.segment_local(m_node, m_offset)); }
+    bool is_local(my_mpi &mpi) const { return local(mpi) != nullptr; }
+
+    global_ptr operator+(std::ptrdiff_t n) const { return { m_node, m_offset + n*sizeof(T) }; }
+    global_ptr operator-(std::ptrdiff_t n) const { return { m_node, m_offset - n*sizeof(T) }; }
+
+    bool operator==(const global_ptr &other) const { return m_node == other.m_node && m_offset == other.m_offset; }
+    bool operator!=(const global_ptr &other) const { return !(*this == other); }
+
+private:
+    int m_node{ -1 };
+    std::size_t m_offset{ 0 };
+};
+
+namespace my_mpi_detail
+{
+    // finishes a get before the buffer it lands in can be freed, also if its future is dropped early
+    struct pending_get_t
+    {
+        my_future<void> done;
+        ~pending_get_t() { done.wait(); }
+    };
+}
+
+template<typename T>
+my_future<T> rget(my_mpi &mpi, global_ptr<T> src)
+{
+    if( auto local = src.local(mpi) )
+        return my_future<T>::make_ready(*local);
+
+    my_future<T> future;
+    auto pending = std::make_shared<my_mpi_detail::pending_get_t>();
+    pending->done = mpi.get_bytes(&future.state()->value, src.where(), src.offset(), sizeof(T));
+
+    // the state is the landing buffer. test must not hold the state itself, or the state would own
+    // itself and never be freed; test is destroyed before the value, so the get is done by then
+    future.state()->test = [pending](){ return pending->done.ready(); };
+
+    return future;
+}
+
+template<typename T>
+my_future<void> rget(my_mpi &mpi, global_ptr<T> src, T *dest, std::size_t count)
+{
+    return mpi.get_bytes(dest, src.where(), src.offset(), count*sizeof(T));
+}
+
+template<typename T>
+my_future<void> rput(my_mpi &mpi, const T &value, global_ptr<T> dest)
+{
+    if( auto local = dest.local(mpi) )
+    {
+        *local = value;
+        return my_future<void>::make_ready();
+    }
+
+    return mpi.put_bytes(dest.where(), dest.offset(), &value, sizeof(T));
+}
+
+template<typename T>
+my_future<void> rput(my_mpi &mpi, const T *src, global_ptr<T> dest, std::size_t count)
+{
+    return mpi.put_bytes(dest.where(), dest.offset(), src, count*sizeof(T));
+}
+
+#endif // GLOBAL_PTR_H
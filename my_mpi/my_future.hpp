@@ -0,0 +1,85 @@
+/*
+ * minimal future for the asynchronous operations of my_mpi
+ */
+
+#ifndef MY_FUTURE_H
+#define MY_FUTURE_H
+
+#include <memory>
+#include <functional>
+#include <utility>
+#include <cstddef>
+
+// polls the network once, implemented in my_mpi.cpp
+void my_mpi_progress();
+
+// called after every unsuccessful poll of a wait, polls counts them (see my_mpi_config::wait_policy)
+void my_mpi_backoff(std::size_t &polls);
+
+// value of a my_future<void>
+struct my_future_void_t {};
+
+template<typename T> struct my_future_value { typedef T type; };
+template<> struct my_future_value<void> { typedef my_future_void_t type; };
+
+template<typename T>
+class my_future
+{
+public:
+    typedef typename my_future_value<T>::type value_t;
+
+    struct state_t
+    {
+        bool ready{ false };
+        value_t value{};
+
+        // optional, completes the future once it returns true (e.g. by syncing a gasnet handle)
+        std::function<bool()> test;
+    };
+
+    my_future() : m_state(std::make_shared<state_t>()) {}
+
+    static my_future make_ready(value_t value = value_t())
+    {
+        my_future f;
+        f.m_state->value = std::move(value);
+        f.m_state->ready = true;
+        return f;
+    }
+
+    bool ready() const
+    {
+        if( !m_state->ready && m_state->test && m_state->test() )
+        {
+            m_state->ready = true;
+            m_state->test = nullptr;
+        }
+
+        return m_state->ready;
+    }
+
+    void wait() const
+    {
+        std::size_t polls = 0;
+        
+        while( !ready() )
+        {
+            my_mpi_progress();
+            my_mpi_backoff(polls);
+        }
+    }
+
+    const value_t &get() const
+    {
+        wait();
+        return m_state->value;
+    }
+
+    // used by the producer side to fill in the value
+    const std::shared_ptr<state_t> &state() const { return m_state; }
+
+private:
+    std::shared_ptr<state_t> m_state;
+};
+
+#endif // MY_FUTURE_H
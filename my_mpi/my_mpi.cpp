@@ -6,6 +6,17 @@
 #include <algorithm>
 #include <iostream>
 #include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <new>
+#include <memory>
+#include <stdexcept>
+#include <deque>
+#include <map>
+#include <functional>
+#include <random>
+#include <thread>
+#include <chrono>
 
 #include <gasnet.h>
 
@@ -15,65 +26,1303 @@
         gasnet_barrier_wait(0,GASNET_BARRIERFLAG_ANONYMOUS); \
     } while (0); \
     
+// all AM handlers of my_mpi, registered in the constructor
+const gasnet_handler_t message_req_id  = 200;
+const gasnet_handler_t message_rep_id  = 201;
+const gasnet_handler_t chunk_notify_id = 202;
+const gasnet_handler_t chunk_credit_id = 203;
+const gasnet_handler_t rpc_req_id      = 204;
+const gasnet_handler_t rpc_rep_id      = 205;
+const gasnet_handler_t atomic_req_id   = 206;
+const gasnet_handler_t atomic_rep_id   = 207;
+const gasnet_handler_t steal_req_id    = 208;
+const gasnet_handler_t steal_rep_id    = 209;
+const gasnet_handler_t termination_token_id = 210;
+const gasnet_handler_t termination_done_id  = 211;
+const gasnet_handler_t object_call_id  = 212;
+
 struct message_t
 {
-    message_t(int _id, std::size_t _size, const void *buf) : id(_id), size(_size) 
-    { 
-        data = new char[size]; 
-        std::memcpy(data, buf, size);
-    }
-    ~message_t() { /*delete[] data;*/ }
-    int id;
-    char *data;
-    std::size_t size;
+    message_t(int _id, std::size_t _size, const void *buf) : id(_id), size(_size), received(_size) 
+    { 
+        data = new char[size]; 
+        if( size != 0 ) std::memcpy(data, buf, size);
+    }
+    
+    // message of this rank to itself, data stays in the sender's buffer
+    message_t(int _id, std::size_t _size, const char *buf, std::shared_ptr<my_mpi_detail::moved_buffer> _moved) : 
+        id(_id), data(const_cast<char *>(buf)), size(_size), received(_size), moved(std::move(_moved))
+    {
+    }
+    
+    // chunked message, filled while its chunks arrive
+    message_t(int _id, std::size_t _size, int _src, int _seq, std::size_t num_chunks) : 
+        id(_id), size(_size), received(0), src(_src), seq(_seq), chunk_done(num_chunks, 0)
+    {
+        data = new char[size];
+    }
+    
+    ~message_t() { /*delete[] data;*/ }
+    int id;
+    char *data;
+    std::size_t size;
+    std::size_t received;
+    
+    int src{ -1 };
+    int seq{ -1 };
+    std::vector<std::uint8_t> chunk_done;
+    std::size_t chunks_contiguous{ 0 };
+    
+    // chunked message assembled directly in the buffer of a posted receive
+    std::shared_ptr<my_mpi_posted_recv_t> posted;
+    
+    std::shared_ptr<my_mpi_detail::moved_buffer> moved;
+};
+
+std::vector<message_t> g_recv_messages;
+int g_pending_messages{ 0 };
+
+/*
+ * posted receives, matched in the order they were posted: a message matching one lands 
+ * directly in its buffer, all others are copied into g_recv_messages (the unexpected 
+ * queue) until somebody asks for them
+ */
+std::deque<std::shared_ptr<my_mpi_posted_recv_t>> g_posted_recvs;
+
+std::shared_ptr<my_mpi_posted_recv_t> claim_posted(int id, std::size_t size)
+{
+    auto found = std::find_if(g_posted_recvs.begin(), g_posted_recvs.end(), [&](auto &p){ return p->id == id; });
+    
+    if( found == g_posted_recvs.end() )
+        return nullptr;
+    
+    auto posted = *found;
+    g_posted_recvs.erase(found);
+    
+    // too large messages stay unexpected, the receiver reports them
+    if( posted->capacity < size )
+    {
+        posted->truncated = true;
+        return nullptr;
+    }
+    
+    return posted;
+}
+
+// moved: the sender gave up data, it is queued without a copy
+void deliver_message(int id, const void *data, std::size_t size, std::shared_ptr<my_mpi_detail::moved_buffer> moved = nullptr)
+{
+    if( auto posted = claim_posted(id, size) )
+    {
+        if( size != 0 ) std::memcpy(posted->buffer, data, size);
+        posted->size = size;
+        posted->done = true;
+        return;
+    }
+    
+    if( moved )
+        g_recv_messages.push_back( message_t(id, size, static_cast<const char *>(data), std::move(moved)) );
+    else
+        g_recv_messages.push_back( message_t(id, size, data) );
+}
+
+// staging area for send_iov(), reused so that vectored sends do not allocate
+std::vector<char> g_iov_buffer;
+
+/*
+ * segment bookkeeping
+ * 
+ * every rank carves its segment in the same order and with the same sizes, 
+ * so an offset is valid on all ranks
+ */
+std::vector<gasnet_seginfo_t> g_seginfo;
+std::vector<gasnet_nodeinfo_t> g_nodeinfo;
+std::size_t g_segment_used{ 0 };
+
+constexpr std::size_t cache_line = 64;
+
+std::size_t round_up(std::size_t size, std::size_t alignment)
+{
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+// returns the offset of the reserved block or SIZE_MAX if the segment is too small
+std::size_t segment_reserve(std::size_t size)
+{
+    auto offset = round_up(g_segment_used, cache_line);
+    
+    if( offset + size > g_seginfo[gasnet_mynode()].size )
+        return SIZE_MAX;
+    
+    g_segment_used = offset + size;
+    return offset;
+}
+
+// address of an offset in the segment of node, as seen from this process
+char *segment_address(int node, std::size_t offset)
+{
+#ifdef GASNET_PSHM
+    return static_cast<char *>(g_seginfo[node].addr) + g_nodeinfo[node].offset + offset;
+#else
+    return static_cast<char *>(g_seginfo[node].addr) + offset;
+#endif
+}
+
+/*
+ * shared-memory transport
+ * 
+ * every rank owns one single-producer/single-consumer ring per rank of its 
+ * supernode. small messages are inlined into the slots, larger ones are 
+ * copied into one of shm_bounce_slots bounce buffers in the sender's segment 
+ * and the slot only announces them. the receiver copies them out and frees 
+ * the bounce buffer, so large messages take two copies: the user buffer of 
+ * the sender is not in the segment and can't be read by the receiver.
+ */
+struct shm_ring_t
+{
+    alignas(cache_line) std::atomic<std::uint64_t> tail;  // written by the producer
+    alignas(cache_line) std::atomic<std::uint64_t> head;  // written by the consumer
+};
+
+struct shm_slot_t
+{
+    int id;
+    std::uint32_t size;
+    std::uint32_t bounce;           // 0: inlined into the slot, otherwise index+1 of the bounce buffer
+};
+
+struct shm_bounce_t
+{
+    alignas(cache_line) std::atomic<std::uint32_t> busy;
+};
+
+my_mpi_config g_config;
+
+// node map, hosts are taken from the GASNet node info
+std::vector<int> g_node_ranks;
+std::vector<int> g_node_leaders;
+std::vector<int> g_leader_of;
+int g_collective_seq{ 0 };
+
+void node_map_setup()
+{
+    const int nodes = gasnet_nodes();
+    
+    g_leader_of.assign(nodes, -1);
+    
+    // ranks are visited in ascending order, so the first one seen on a host becomes its leader
+    for(int n=0; n<nodes; ++n)
+    {
+        for(int l : g_node_leaders)
+        {
+            if( g_nodeinfo[l].host == g_nodeinfo[n].host )
+            {
+                g_leader_of[n] = l;
+                break;
+            }
+        }
+        
+        if( g_leader_of[n] < 0 )
+        {
+            g_leader_of[n] = n;
+            g_node_leaders.push_back(n);
+        }
+        
+        if( g_nodeinfo[n].host == g_nodeinfo[gasnet_mynode()].host )
+            g_node_ranks.push_back(n);
+    }
+}
+std::vector<int> g_local_index;     // index of a rank in its supernode or -1 if not reachable via shm
+std::vector<int> g_local_ranks;     // ranks of this supernode
+std::size_t g_shm_max_local{ 0 };        // ranks of the largest supernode, the layout is sized for it
+std::size_t g_shm_slot_stride{ 0 };
+std::size_t g_shm_ring_stride{ 0 };
+std::size_t g_shm_bounce_stride{ 0 };
+std::size_t g_shm_rings_offset{ 0 };
+std::size_t g_shm_bounce_offset{ 0 };
+std::vector<std::size_t> g_shm_bounce_next;     // bounce buffer for the next large message per receiver
+
+shm_ring_t *shm_ring(int owner, int producer)
+{
+    return reinterpret_cast<shm_ring_t *>(segment_address(owner, g_shm_rings_offset + g_local_index[producer]*g_shm_ring_stride));
+}
+
+shm_slot_t *shm_slot(shm_ring_t *ring, std::uint64_t n)
+{
+    return reinterpret_cast<shm_slot_t *>(reinterpret_cast<char *>(ring) + sizeof(shm_ring_t) + (n % g_config.shm_ring_slots)*g_shm_slot_stride);
+}
+
+shm_bounce_t *shm_bounce(int owner, int consumer, std::size_t index)
+{
+    const auto n = g_local_index[consumer]*g_config.shm_bounce_slots + index;
+    return reinterpret_cast<shm_bounce_t *>(segment_address(owner, g_shm_bounce_offset + n*g_shm_bounce_stride));
+}
+
+/*
+ * sets the strides and returns the segment bytes of the rings and bounce buffers, 0 if no
+ * rank has a shm peer. the layout must be identical on all ranks, so it is sized for the
+ * largest supernode. needs g_nodeinfo, but not the segment.
+ */
+std::size_t shm_layout()
+{
+#ifdef GASNET_PSHM
+    const int nodes = gasnet_nodes();
+    
+    if( !g_config.use_shm || g_config.shm_bounce_slots == 0 )
+        return 0;
+    
+    std::vector<int> supernode_sizes(nodes, 0);
+    for(int n=0; n<nodes; ++n)
+        supernode_sizes[g_nodeinfo[n].supernode]++;
+    
+    g_shm_max_local = *std::max_element(supernode_sizes.begin(), supernode_sizes.end());
+    
+    if( g_shm_max_local < 2 )
+        return 0;
+    
+    g_shm_slot_stride   = round_up(sizeof(shm_slot_t) + g_config.shm_slot_size, cache_line);
+    g_shm_ring_stride   = round_up(sizeof(shm_ring_t) + g_config.shm_ring_slots*g_shm_slot_stride, cache_line);
+    g_shm_bounce_stride = round_up(sizeof(shm_bounce_t) + g_config.shm_bounce_size, cache_line);
+    
+    return g_shm_max_local*(g_shm_ring_stride + g_config.shm_bounce_slots*g_shm_bounce_stride);
+#else
+    return 0;
+#endif
+}
+
+void shm_setup()
+{
+    const int me = gasnet_mynode();
+    const int nodes = gasnet_nodes();
+    
+    g_local_index.assign(nodes, -1);
+    
+#ifdef GASNET_PSHM
+    // no single rank has a peer: everything takes the AM path
+    if( shm_layout() == 0 )
+        return;
+    
+    g_shm_rings_offset  = segment_reserve(g_shm_max_local*g_shm_ring_stride);
+    g_shm_bounce_offset = segment_reserve(g_shm_max_local*g_config.shm_bounce_slots*g_shm_bounce_stride);
+    
+    if( g_shm_rings_offset == SIZE_MAX || g_shm_bounce_offset == SIZE_MAX )
+    {
+        if( me == 0 )
+            std::cout << "my_mpi: segment too small for shared-memory transport, using AM only" << std::endl;
+        return;
+    }
+    
+    for(int n=0; n<nodes; ++n)
+    {
+        if( g_nodeinfo[n].supernode == g_nodeinfo[me].supernode )
+        {
+            g_local_index[n] = g_local_ranks.size();
+            g_local_ranks.push_back(n);
+        }
+    }
+    
+    for(auto peer : g_local_ranks)
+    {
+        auto ring = shm_ring(me, peer);
+        new (&ring->tail) std::atomic<std::uint64_t>(0);
+        new (&ring->head) std::atomic<std::uint64_t>(0);
+        
+        for(std::size_t b=0; b<g_config.shm_bounce_slots; ++b)
+            new (&shm_bounce(me, peer, b)->busy) std::atomic<std::uint32_t>(0);
+    }
+    
+    g_shm_bounce_next.assign(nodes, 0);
+#endif
+}
+
+void shm_poll()
+{
+    const int me = gasnet_mynode();
+    
+    for(auto peer : g_local_ranks)
+    {
+        auto ring = shm_ring(me, peer);
+        auto head = ring->head.load(std::memory_order_relaxed);
+        auto tail = ring->tail.load(std::memory_order_acquire);
+        
+        if( head == tail )
+            continue;
+        
+        for(; head != tail; ++head)
+        {
+            auto slot = shm_slot(ring, head);
+            
+            if( slot->bounce )
+            {
+                auto bounce = shm_bounce(peer, me, slot->bounce - 1);
+                deliver_message(slot->id, bounce + 1, slot->size);
+                bounce->busy.store(0, std::memory_order_release);
+            }
+            else
+            {
+                deliver_message(slot->id, slot + 1, slot->size);
+            }
+        }
+        
+        ring->head.store(head, std::memory_order_release);
+    }
+}
+
+// returns false if the message has to take the AM path
+bool shm_send(int dest_node, int id, const char *data, std::size_t size)
+{
+    const int me = gasnet_mynode();
+    
+    if( g_local_index[dest_node] < 0 || size > g_config.shm_bounce_size )
+        return false;
+    
+    std::uint32_t bounce_index = 0;
+    
+    if( size > g_config.shm_slot_size )
+    {
+        // the buffers are released in the order they were taken, so the next one is the oldest
+        auto &next = g_shm_bounce_next[dest_node];
+        auto bounce = shm_bounce(me, dest_node, next);
+        
+        bounce_index = next + 1;
+        next = (next + 1) % g_config.shm_bounce_slots;
+        
+        // keep draining our own rings while waiting, so two ranks sending to each other cannot deadlock
+        std::size_t polls = 0;
+        
+        while( bounce->busy.load(std::memory_order_acquire) )
+        {
+            shm_poll();
+            gasnet_AMPoll();
+            my_mpi_backoff(polls);
+        }
+        
+        std::memcpy(reinterpret_cast<char *>(bounce + 1), data, size);
+        bounce->busy.store(1, std::memory_order_relaxed);
+    }
+    
+    auto ring = shm_ring(dest_node, me);
+    auto tail = ring->tail.load(std::memory_order_relaxed);
+    std::size_t polls = 0;
+    
+    while( tail - ring->head.load(std::memory_order_acquire) >= g_config.shm_ring_slots )
+    {
+        shm_poll();
+        gasnet_AMPoll();
+        my_mpi_backoff(polls);
+    }
+    
+    auto slot = shm_slot(ring, tail);
+    slot->id = id;
+    slot->size = size;
+    slot->bounce = bounce_index;
+    
+    // barrier() and other empty messages pass nullptr
+    if( bounce_index == 0 && size != 0 )
+        std::memcpy(slot + 1, data, size);
+    
+    ring->tail.store(tail + 1, std::memory_order_release);
+    
+    return true;
+}
+
+/*
+ * eager RDMA transport
+ * 
+ * every rank owns one ring of eager_slots slots per sender in its segment. the sender puts 
+ * id, size and payload with a blocking put, which has completed at the target when it returns, 
+ * and only then the sequence number at the front of the slot with a second put of one word. 
+ * GASNet does not order the bytes of a single put, so the flag must not travel with the data.
+ * the receiver polls the sequence number of the next slot in every ring, without running an 
+ * AM handler, and clears it when it consumes the slot. consumed slots are returned in batches 
+ * by putting the consumer's head into a credit word in the sender's segment.
+ */
+struct eager_header_t
+{
+    std::uint64_t seq;
+    int id;
+    std::uint32_t size;
+};
+
+std::size_t g_eager_slot_stride{ 0 };
+std::size_t g_eager_rings_offset{ 0 };
+std::size_t g_eager_credits_offset{ 0 };
+std::vector<int> g_eager_peers;                 // ranks reached via eager RDMA
+std::vector<std::uint64_t> g_eager_tail;        // messages sent per receiver
+std::vector<std::uint64_t> g_eager_head;        // messages consumed per sender
+std::vector<std::uint64_t> g_eager_returned;    // head last put into the sender's credit word
+std::vector<gasnet_handle_t> g_eager_credit_put;    // the credit put still in flight per sender
+std::vector<char> g_eager_staging;
+
+bool eager_enabled(int node)
+{
+    return g_eager_slot_stride != 0 && node != static_cast<int>(gasnet_mynode()) && g_local_index[node] < 0;
+}
+
+std::size_t eager_slot_offset(int sender, std::uint64_t n)
+{
+    return g_eager_rings_offset + (sender*g_config.eager_slots + n % g_config.eager_slots)*g_eager_slot_stride;
+}
+
+std::size_t eager_credit_offset(int receiver)
+{
+    return g_eager_credits_offset + receiver*cache_line;
+}
+
+// after shm_setup(), only ranks outside the own supernode use the rings
+void eager_setup()
+{
+    const int me = gasnet_mynode();
+    const int nodes = gasnet_nodes();
+    
+    if( !g_config.use_eager_rdma || g_config.eager_slots == 0 )
+        return;
+    
+    const auto stride = round_up(sizeof(eager_header_t) + g_config.eager_slot_size, cache_line);
+    
+    g_eager_rings_offset = segment_reserve(nodes*g_config.eager_slots*stride);
+    g_eager_credits_offset = segment_reserve(nodes*cache_line);
+    
+    if( g_eager_rings_offset == SIZE_MAX || g_eager_credits_offset == SIZE_MAX )
+    {
+        if( me == 0 )
+            std::cout << "my_mpi: segment too small for eager RDMA, using AM only" << std::endl;
+        return;
+    }
+    
+    g_eager_slot_stride = stride;
+    
+    std::memset(segment_address(me, g_eager_rings_offset), 0, nodes*g_config.eager_slots*stride);
+    std::memset(segment_address(me, g_eager_credits_offset), 0, nodes*cache_line);
+    
+    g_eager_tail.assign(nodes, 0);
+    g_eager_head.assign(nodes, 0);
+    g_eager_returned.assign(nodes, 0);
+    g_eager_credit_put.assign(nodes, GASNET_INVALID_HANDLE);
+    g_eager_staging.resize(stride);
+    
+    for(int n=0; n<nodes; ++n)
+        if( eager_enabled(n) )
+            g_eager_peers.push_back(n);
+}
+
+std::uint64_t eager_load(const char *address)
+{
+    return __atomic_load_n(reinterpret_cast<const std::uint64_t *>(address), __ATOMIC_ACQUIRE);
+}
+
+void eager_poll()
+{
+    const int me = gasnet_mynode();
+    
+    for(auto peer : g_eager_peers)
+    {
+        auto &head = g_eager_head[peer];
+        
+        while( true )
+        {
+            auto slot = segment_address(me, eager_slot_offset(peer, head));
+            
+            if( eager_load(slot) != head + 1 )
+                break;
+            
+            eager_header_t header;
+            std::memcpy(&header, slot, sizeof(header));
+            
+            deliver_message(header.id, slot + sizeof(header), header.size);
+            
+            // the sender reuses the slot once the credit is back, no stale number may be left in it
+            __atomic_store_n(reinterpret_cast<std::uint64_t *>(slot), 0, __ATOMIC_RELEASE);
+            head++;
+        }
+        
+        // non-blocking, progress() must not wait a round trip; credits grow, so a late put is only stale
+        auto &credit_put = g_eager_credit_put[peer];
+        
+        if( credit_put != GASNET_INVALID_HANDLE && gasnet_try_syncnb(credit_put) == GASNET_OK )
+            credit_put = GASNET_INVALID_HANDLE;
+        
+        if( credit_put == GASNET_INVALID_HANDLE && head - g_eager_returned[peer] >= std::max<std::size_t>(g_config.eager_slots / 2, 1) )
+        {
+            credit_put = gasnet_put_nb_val(peer, static_cast<char *>(g_seginfo[peer].addr) + eager_credit_offset(me), head, sizeof(std::uint64_t));
+            g_eager_returned[peer] = head;
+        }
+    }
+}
+
+// returns false if the message has to take the AM path
+bool eager_send(int dest_node, int id, const char *data, std::size_t size)
+{
+    const int me = gasnet_mynode();
+    
+    if( size > g_config.eager_slot_size || !eager_enabled(dest_node) )
+        return false;
+    
+    auto &tail = g_eager_tail[dest_node];
+    auto credit = segment_address(me, eager_credit_offset(dest_node));
+    
+    // keep draining our own rings while waiting, so two ranks sending to each other cannot deadlock
+    std::size_t polls = 0;
+    
+    while( tail - eager_load(credit) >= g_config.eager_slots )
+    {
+        eager_poll();
+        gasnet_AMPoll();
+        my_mpi_backoff(polls);
+    }
+    
+    const std::uint64_t seq = tail + 1;
+    const eager_header_t header = { seq, id, static_cast<std::uint32_t>(size) };
+    const auto flag = sizeof(header.seq);
+    
+    std::memcpy(g_eager_staging.data(), &header, sizeof(header));
+    if( size != 0 ) std::memcpy(g_eager_staging.data() + sizeof(header), data, size);
+    
+    auto slot = static_cast<char *>(g_seginfo[dest_node].addr) + eager_slot_offset(me, tail);
+    
+    // everything but the sequence number first, the message is complete once that lands
+    gasnet_put(dest_node, slot + flag, g_eager_staging.data() + flag, sizeof(header) - flag + size);
+    gasnet_put_val(dest_node, slot, seq, sizeof(seq));
+    tail++;
+    
+    return true;
+}
+
+/*
+ * chunked transfer of large messages
+ * 
+ * every rank has chunk_depth landing slots of chunk_size bytes per sender in its segment.
+ * the sender puts the chunks back to back with put_nbi, each in its own access region, and 
+ * announces every completed chunk with an AM. the handler copies it into the message and 
+ * returns the slot, so the receiver can consume the message while it is still arriving.
+ */
+std::size_t g_chunk_size{ 0 };
+std::size_t g_chunk_threshold{ 0 };
+std::size_t g_chunk_offset{ 0 };
+std::vector<int> g_chunk_send_seq;
+std::vector<std::vector<int>> g_chunk_free_slots;
+
+std::size_t chunk_slot_offset(int src, int slot)
+{
+    return g_chunk_offset + (src*g_config.chunk_depth + slot)*g_chunk_size;
+}
+
+void chunk_setup()
+{
+    const int nodes = gasnet_nodes();
+    
+    g_chunk_threshold = g_config.chunk_threshold != 0 ? g_config.chunk_threshold : gasnet_AMMaxMedium();
+    g_chunk_size = std::max(g_config.chunk_size / cache_line * cache_line, cache_line);
+    g_chunk_offset = segment_reserve(nodes*g_config.chunk_depth*g_chunk_size);
+    
+    if( g_chunk_offset == SIZE_MAX )
+        throw std::runtime_error("my_mpi: segment too small for the chunk landing zones");
+    
+    g_chunk_send_seq.assign(nodes, 0);
+    g_chunk_free_slots.assign(nodes, std::vector<int>());
+    
+    for(auto &slots : g_chunk_free_slots)
+        for(std::size_t s=0; s<g_config.chunk_depth; ++s)
+            slots.push_back(s);
+}
+
+void chunk_notify_handler(gasnet_token_t token, int id, int seq, int chunk, int slot, int length, 
+                          gasnet_handlerarg_t size_lo, gasnet_handlerarg_t size_hi)
+{
+    gasnet_node_t src;
+    gasnet_AMGetMsgSource(token, &src);
+    
+    const auto size = static_cast<std::size_t>(static_cast<std::uint32_t>(size_hi)) << 32 | static_cast<std::uint32_t>(size_lo);
+    const auto num_chunks = (size + g_chunk_size - 1) / g_chunk_size;
+    
+    auto msg = std::find_if(g_recv_messages.begin(), g_recv_messages.end(), [&](auto &m){ return m.src == static_cast<int>(src) && m.seq == seq; });
+    
+    if( msg == g_recv_messages.end() )
+    {
+        g_recv_messages.push_back( message_t(id, size, src, seq, num_chunks) );
+        msg = g_recv_messages.end() - 1;
+        
+        if( auto posted = claim_posted(id, size) )
+        {
+            delete[] msg->data;
+            msg->data = posted->buffer;
+            msg->posted = posted;
+        }
+    }
+    
+    std::memcpy(msg->data + chunk*g_chunk_size, segment_address(gasnet_mynode(), chunk_slot_offset(src, slot)), length);
+    
+    msg->received += length;
+    msg->chunk_done[chunk] = 1;
+    
+    while( msg->chunks_contiguous < num_chunks && msg->chunk_done[msg->chunks_contiguous] )
+        msg->chunks_contiguous++;
+    
+    if( msg->posted && msg->received == msg->size )
+    {
+        msg->posted->size = msg->size;
+        msg->posted->done = true;
+        g_recv_messages.erase(msg);
+    }
+    
+    gasnet_AMReplyShort1(token, chunk_credit_id, slot);
+}
+
+void chunk_credit_handler(gasnet_token_t token, int slot)
+{
+    gasnet_node_t src;
+    gasnet_AMGetMsgSource(token, &src);
+    
+    g_chunk_free_slots[src].push_back(slot);
+}
+
+struct chunk_in_flight_t
+{
+    gasnet_handle_t handle;
+    int chunk, slot, length;
+};
+
+// blocks until all chunks have left the source buffer
+struct chunked_send_t
+{
+    int dest_node, id, seq;
+    const char *data;
+    std::size_t size;
+    std::size_t next_chunk;
+    std::vector<chunk_in_flight_t> in_flight;
+    
+    // set for sends that own their buffer, it is freed once the last chunk has left
+    std::shared_ptr<my_mpi_detail::moved_buffer> owner;
+};
+
+// sends of moved buffers, advanced by my_mpi_progress()
+std::deque<chunked_send_t> g_background_sends;
+
+chunked_send_t chunked_begin(int dest_node, int id, const char *data, std::size_t size)
+{
+    return { dest_node, id, g_chunk_send_seq[dest_node]++, data, size, 0, {}, nullptr };
+}
+
+// issues and announces what it can without waiting, returns true once the send is complete
+bool chunked_step(chunked_send_t &send)
+{
+    const auto num_chunks = (send.size + g_chunk_size - 1) / g_chunk_size;
+    const auto size_lo = static_cast<gasnet_handlerarg_t>(send.size & 0xFFFFFFFF);
+    const auto size_hi = static_cast<gasnet_handlerarg_t>(send.size >> 32);
+    auto &free_slots = g_chunk_free_slots[send.dest_node];
+    auto &in_flight = send.in_flight;
+    
+    // issue as many chunks as there are free slots at the receiver
+    while( send.next_chunk < num_chunks && !free_slots.empty() )
+    {
+        const int slot = free_slots.back();
+        free_slots.pop_back();
+        
+        const auto offset = send.next_chunk*g_chunk_size;
+        const auto length = std::min(g_chunk_size, send.size - offset);
+        
+        gasnet_begin_nbi_accessregion();
+        gasnet_put_nbi_bulk(send.dest_node, static_cast<char *>(g_seginfo[send.dest_node].addr) + chunk_slot_offset(gasnet_mynode(), slot), 
+                            const_cast<char *>(send.data) + offset, length);
+        
+        in_flight.push_back({ gasnet_end_nbi_accessregion(), static_cast<int>(send.next_chunk), slot, static_cast<int>(length) });
+        send.next_chunk++;
+    }
+    
+    // announce completed chunks
+    auto done = std::partition(in_flight.begin(), in_flight.end(), [](auto &c){ return gasnet_try_syncnb(c.handle) != GASNET_OK; });
+    
+    for(auto c = done; c != in_flight.end(); ++c)
+        gasnet_AMRequestShort7(send.dest_node, chunk_notify_id, send.id, send.seq, c->chunk, c->slot, c->length, size_lo, size_hi);
+    
+    in_flight.erase(done, in_flight.end());
+    
+    return send.next_chunk == num_chunks && in_flight.empty();
+}
+
+void background_sends_step()
+{
+    auto done = std::remove_if(g_background_sends.begin(), g_background_sends.end(), [](auto &send){ return chunked_step(send); });
+    g_background_sends.erase(done, g_background_sends.end());
+}
+
+void chunked_send(int dest_node, int id, const char *data, std::size_t size)
+{
+    std::size_t polls = 0;
+    
+    // moved buffers sent earlier to the same rank go first, so they keep their order
+    while( std::any_of(g_background_sends.begin(), g_background_sends.end(), [&](auto &send){ return send.dest_node == dest_node; }) )
+    {
+        background_sends_step();
+        gasnet_AMPoll();
+        my_mpi_backoff(polls);
+    }
+    
+    auto send = chunked_begin(dest_node, id, data, size);
+    polls = 0;
+    
+    while( !chunked_step(send) )
+    {
+        gasnet_AMPoll();
+        my_mpi_backoff(polls);
+    }
+}
+
+void req_message_transfer(gasnet_token_t token, void *buf, size_t size, int id)
+{
+    deliver_message(id, buf, size);
+    gasnet_AMReplyShort0(token, message_rep_id);
+}
+
+void rep_message_transfer(gasnet_token_t) 
+{
+    g_pending_messages--;
+}
+
+/*
+ * rpc
+ * 
+ * function pointers travel as offsets to rpc_anchor(), which are the same in every 
+ * process of one executable. requests and replies are queued by the handlers, the 
+ * functions and the on_reply callbacks run in progress().
+ */
+void rpc_anchor() {}
+
+struct rpc_request_t
+{
+    int src;
+    int reply_id;
+    my_mpi_rpc_invoker_t invoker;
+    void (*fn)();
+    std::vector<char> args;
+};
+
+std::deque<rpc_request_t> g_rpc_requests;
+std::map<int, std::function<void(const char *, std::size_t)>> g_rpc_replies;
+std::deque<std::pair<int, std::vector<char>>> g_rpc_arrived;   // reply id and payload, not yet handed to on_reply
+int g_rpc_next_id{ 0 };
+
+std::uint64_t pointer_offset(void (*ptr)())
+{
+    return static_cast<std::uint64_t>(reinterpret_cast<std::intptr_t>(ptr) - reinterpret_cast<std::intptr_t>(&rpc_anchor));
+}
+
+template<typename ptr_t>
+ptr_t offset_pointer(std::uint64_t offset)
+{
+    return reinterpret_cast<ptr_t>(reinterpret_cast<std::intptr_t>(&rpc_anchor) + static_cast<std::intptr_t>(offset));
+}
+
+void split_pointer(void (*ptr)(), gasnet_handlerarg_t &lo, gasnet_handlerarg_t &hi)
+{
+    auto offset = pointer_offset(ptr);
+    lo = static_cast<gasnet_handlerarg_t>(offset & 0xFFFFFFFF);
+    hi = static_cast<gasnet_handlerarg_t>(offset >> 32);
+}
+
+template<typename ptr_t>
+ptr_t join_pointer(gasnet_handlerarg_t lo, gasnet_handlerarg_t hi)
+{
+    return offset_pointer<ptr_t>(static_cast<std::uint64_t>(static_cast<std::uint32_t>(hi)) << 32 | static_cast<std::uint32_t>(lo));
+}
+
+void rpc_request_handler(gasnet_token_t token, void *buf, size_t size, gasnet_handlerarg_t invoker_lo, gasnet_handlerarg_t invoker_hi, 
+                         gasnet_handlerarg_t fn_lo, gasnet_handlerarg_t fn_hi, gasnet_handlerarg_t reply_id)
+{
+    gasnet_node_t src;
+    gasnet_AMGetMsgSource(token, &src);
+    
+    auto args = static_cast<const char *>(buf);
+    
+    g_rpc_requests.push_back({ static_cast<int>(src), reply_id, join_pointer<my_mpi_rpc_invoker_t>(invoker_lo, invoker_hi), 
+                               join_pointer<void (*)()>(fn_lo, fn_hi), std::vector<char>(args, args + size) });
+}
+
+void rpc_reply_handler(gasnet_token_t, void *buf, size_t size, gasnet_handlerarg_t reply_id)
+{
+    auto reply = static_cast<const char *>(buf);
+    g_rpc_arrived.emplace_back(reply_id, std::vector<char>(reply, reply + size));
+}
+
+/*
+ * calls on registered objects run inside the handler and answer through the rpc reply
+ */
+std::vector<void *> g_objects;
+
+void object_call_handler(gasnet_token_t token, void *buf, size_t size, gasnet_handlerarg_t invoker_lo, gasnet_handlerarg_t invoker_hi, 
+                         gasnet_handlerarg_t object_id, gasnet_handlerarg_t reply_id)
+{
+    std::vector<char> reply;
+    
+    // no exception may leave a handler, a call on an unregistered object ends the job
+    if( object_id < 0 || static_cast<std::size_t>(object_id) >= g_objects.size() || g_objects[object_id] == nullptr )
+    {
+        std::cerr << "my_mpi: call on unregistered object " << object_id << std::endl;
+        gasnet_exit(1);
+    }
+    
+    auto invoker = join_pointer<my_mpi_object_invoker_t>(invoker_lo, invoker_hi);
+    invoker(g_objects[object_id], static_cast<const char *>(buf), size, reply);
+    
+    gasnet_AMReplyMedium1(token, rpc_rep_id, reply.data(), reply.size(), reply_id);
+}
+
+void rpc_execute()
+{
+    std::vector<char> result;
+    
+    // an rpc may communicate and recurse into progress(), so take it off the queue first
+    while( !g_rpc_requests.empty() )
+    {
+        auto request = std::move(g_rpc_requests.front());
+        g_rpc_requests.pop_front();
+        
+        request.invoker(request.fn, request.args.data(), result);
+        
+        if( result.size() > gasnet_AMMaxMedium() )
+            throw std::runtime_error("rpc results must not be larger than gasnet_AMMaxMedium()");
+        
+        gasnet_AMRequestMedium1(request.src, rpc_rep_id, result.data(), result.size(), request.reply_id);
+    }
+    
+    // the same holds for on_reply, it may send and so run the reply handler again
+    while( !g_rpc_arrived.empty() )
+    {
+        auto reply = std::move(g_rpc_arrived.front());
+        g_rpc_arrived.pop_front();
+        
+        auto found = g_rpc_replies.find(reply.first);
+        
+        if( found == g_rpc_replies.end() )
+            throw std::runtime_error("rpc reply " + std::to_string(reply.first) + " answers no pending call");
+        
+        auto on_reply = std::move(found->second);
+        g_rpc_replies.erase(found);
+        
+        on_reply(reply.second.data(), reply.second.size());
+    }
+}
+
+/*
+ * remote atomics
+ * 
+ * the owner applies the operation with CPU atomics inside the handler, so remote 
+ * operations are atomic with respect to shm peers which access the memory directly
+ */
+struct atomic_request_t
+{
+    std::uint64_t offset;
+    std::uint64_t operand;
+    std::uint64_t compare;
+    int op;
+    int size;
+    int reply_id;
+};
+
+std::map<int, std::shared_ptr<my_future<std::uint64_t>::state_t>> g_atomic_replies;
+int g_atomic_next_id{ 0 };
+
+template<typename T>
+std::uint64_t apply_atomic(T *addr, int op, T operand, T compare)
+{
+    switch( static_cast<my_mpi_atomic_op>(op) )
+    {
+        case my_mpi_atomic_op::load:      return __atomic_load_n(addr, __ATOMIC_SEQ_CST);
+        case my_mpi_atomic_op::store:     __atomic_store_n(addr, operand, __ATOMIC_SEQ_CST); return 0;
+        case my_mpi_atomic_op::exchange:  return __atomic_exchange_n(addr, operand, __ATOMIC_SEQ_CST);
+        case my_mpi_atomic_op::fetch_add: return __atomic_fetch_add(addr, operand, __ATOMIC_SEQ_CST);
+        case my_mpi_atomic_op::fetch_and: return __atomic_fetch_and(addr, operand, __ATOMIC_SEQ_CST);
+        case my_mpi_atomic_op::fetch_or:  return __atomic_fetch_or(addr, operand, __ATOMIC_SEQ_CST);
+        case my_mpi_atomic_op::fetch_xor: return __atomic_fetch_xor(addr, operand, __ATOMIC_SEQ_CST);
+        case my_mpi_atomic_op::compare_exchange:
+            // returns the old value, the exchange happened if it equals compare
+            __atomic_compare_exchange_n(addr, &compare, operand, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+            return compare;
+    }
+    
+    throw std::runtime_error("unknown atomic operation");
+}
+
+std::uint64_t apply_atomic(void *addr, int op, int size, std::uint64_t operand, std::uint64_t compare)
+{
+    if( size == 4 )
+        return apply_atomic(static_cast<std::uint32_t *>(addr), op, static_cast<std::uint32_t>(operand), static_cast<std::uint32_t>(compare));
+    else
+        return apply_atomic(static_cast<std::uint64_t *>(addr), op, operand, compare);
+}
+
+void atomic_request_handler(gasnet_token_t token, void *buf, size_t)
+{
+    atomic_request_t request;
+    std::memcpy(&request, buf, sizeof(request));
+    
+    auto result = apply_atomic(segment_address(gasnet_mynode(), request.offset), request.op, request.size, request.operand, request.compare);
+    
+    gasnet_AMReplyShort3(token, atomic_rep_id, request.reply_id, 
+                         static_cast<gasnet_handlerarg_t>(result & 0xFFFFFFFF), static_cast<gasnet_handlerarg_t>(result >> 32));
+}
+
+void atomic_reply_handler(gasnet_token_t, gasnet_handlerarg_t reply_id, gasnet_handlerarg_t result_lo, gasnet_handlerarg_t result_hi)
+{
+    auto found = g_atomic_replies.find(reply_id);
+    
+    found->second->value = static_cast<std::uint64_t>(static_cast<std::uint32_t>(result_hi)) << 32 | static_cast<std::uint32_t>(result_lo);
+    found->second->ready = true;
+    
+    g_atomic_replies.erase(found);
+}
+
+/*
+ * distributed task pool
+ * 
+ * the owner works LIFO on the back of its deque, thieves take the oldest half from the 
+ * front inside the steal handler. termination is detected with counting waves: a token 
+ * travels the ring and sums up created and executed tasks, two consecutive waves with 
+ * identical and balanced sums mean that no task is left anywhere (nor in flight).
+ */
+struct task_t
+{
+    my_mpi_rpc_invoker_t invoker;
+    void (*fn)();
+    std::vector<char> args;
 };
 
-std::vector<message_t> g_recv_messages;
-int g_pending_messages{ 0 };
+struct task_header_t
+{
+    std::uint64_t invoker;
+    std::uint64_t fn;
+    std::uint64_t args_size;
+};
 
-void req_message_transfer(gasnet_token_t token, void *buf, size_t size, int id)
+std::deque<task_t> g_tasks;
+std::uint64_t g_tasks_created{ 0 };
+std::uint64_t g_tasks_executed{ 0 };
+std::uint64_t g_steals_attempted{ 0 };
+std::uint64_t g_steals_succeeded{ 0 };
+bool g_tasks_running{ false };
+bool g_tasks_done{ false };
+bool g_steal_pending{ false };
+
+// termination token, only one wave travels at a time
+bool g_token_here{ false };
+bool g_wave_in_flight{ false };
+std::uint64_t g_token_created{ 0 };
+std::uint64_t g_token_executed{ 0 };
+std::uint64_t g_last_wave_created{ UINT64_MAX };
+std::uint64_t g_last_wave_executed{ UINT64_MAX };
+
+std::uint64_t join_args(gasnet_handlerarg_t lo, gasnet_handlerarg_t hi)
 {
-    g_recv_messages.push_back( message_t(id, size, buf) );
-    gasnet_AMReplyShort0(token, 201);
+    return static_cast<std::uint64_t>(static_cast<std::uint32_t>(hi)) << 32 | static_cast<std::uint32_t>(lo);
 }
 
-void rep_message_transfer(gasnet_token_t token) 
+void steal_request_handler(gasnet_token_t token)
 {
-    g_pending_messages--;
+    std::vector<char> buffer;
+    
+    // the oldest half of the tasks, as long as it fits into one reply
+    auto num_steal = (g_tasks.size() + 1) / 2;
+    
+    while( num_steal-- > 0 )
+    {
+        auto &task = g_tasks.front();
+        auto record_size = sizeof(task_header_t) + task.args.size();
+        
+        if( buffer.size() + record_size > gasnet_AMMaxMedium() )
+            break;
+        
+        task_header_t header = { pointer_offset(reinterpret_cast<void (*)()>(task.invoker)), pointer_offset(task.fn), task.args.size() };
+        
+        auto pos = buffer.size();
+        buffer.resize(pos + record_size);
+        std::memcpy(buffer.data() + pos, &header, sizeof(header));
+        std::memcpy(buffer.data() + pos + sizeof(header), task.args.data(), task.args.size());
+        
+        g_tasks.pop_front();
+    }
+    
+    gasnet_AMReplyMedium0(token, steal_rep_id, buffer.data(), buffer.size());
+}
+
+void steal_reply_handler(gasnet_token_t, void *buf, size_t size)
+{
+    auto pos = static_cast<const char *>(buf);
+    auto end = pos + size;
+    
+    if( pos != end )
+        g_steals_succeeded++;
+    
+    while( pos < end )
+    {
+        task_header_t header;
+        std::memcpy(&header, pos, sizeof(header));
+        pos += sizeof(header);
+        
+        g_tasks.push_back({ offset_pointer<my_mpi_rpc_invoker_t>(header.invoker), offset_pointer<void (*)()>(header.fn), 
+                            std::vector<char>(pos, pos + header.args_size) });
+        pos += header.args_size;
+    }
+    
+    g_steal_pending = false;
+}
+
+void termination_token_handler(gasnet_token_t, gasnet_handlerarg_t created_lo, gasnet_handlerarg_t created_hi, 
+                               gasnet_handlerarg_t executed_lo, gasnet_handlerarg_t executed_hi)
+{
+    g_token_created = join_args(created_lo, created_hi);
+    g_token_executed = join_args(executed_lo, executed_hi);
+    g_token_here = true;
+}
+
+void termination_done_handler(gasnet_token_t)
+{
+    g_tasks_done = true;
+}
+
+void send_token(int dest, std::uint64_t created, std::uint64_t executed)
+{
+    gasnet_AMRequestShort4(dest, termination_token_id, 
+                           static_cast<gasnet_handlerarg_t>(created & 0xFFFFFFFF), static_cast<gasnet_handlerarg_t>(created >> 32), 
+                           static_cast<gasnet_handlerarg_t>(executed & 0xFFFFFFFF), static_cast<gasnet_handlerarg_t>(executed >> 32));
+}
+
+// runs in user context, the token is only passed on by idle ranks
+void termination_step()
+{
+    const int me = gasnet_mynode();
+    const int nodes = gasnet_nodes();
+    
+    if( !g_tasks_running || g_tasks_done || !g_tasks.empty() || g_steal_pending )
+        return;
+    
+    if( nodes == 1 )
+    {
+        g_tasks_done = g_tasks_created == g_tasks_executed;
+        return;
+    }
+    
+    if( me != 0 )
+    {
+        if( g_token_here )
+        {
+            g_token_here = false;
+            send_token((me + 1) % nodes, g_token_created + g_tasks_created, g_token_executed + g_tasks_executed);
+        }
+        return;
+    }
+    
+    if( g_token_here )
+    {
+        g_token_here = false;
+        g_wave_in_flight = false;
+        
+        if( g_token_created == g_token_executed && g_token_created == g_last_wave_created && g_token_executed == g_last_wave_executed )
+        {
+            for(int n=1; n<nodes; ++n)
+                gasnet_AMRequestShort0(n, termination_done_id);
+            
+            g_tasks_done = true;
+            return;
+        }
+        
+        g_last_wave_created = g_token_created;
+        g_last_wave_executed = g_token_executed;
+    }
+    
+    if( !g_wave_in_flight )
+    {
+        g_wave_in_flight = true;
+        send_token(1, g_tasks_created, g_tasks_executed);
+    }
+}
+
+/*
+ * spinning gives the lowest latency but keeps the core busy for the whole wait. yielding 
+ * hands it to other runnable threads and costs little if there are none; sleeping frees 
+ * it completely, but a message arriving during a sleep waits up to wait_sleep_max longer.
+ */
+void my_mpi_backoff(std::size_t &polls)
+{
+    if( g_config.wait_policy == my_mpi_wait_policy::spin || ++polls <= g_config.wait_spins )
+        return;
+    
+    if( g_config.wait_policy == my_mpi_wait_policy::spin_yield )
+    {
+        std::this_thread::yield();
+        return;
+    }
+    
+    const auto doublings = std::min<std::size_t>(polls - g_config.wait_spins - 1, 20);
+    const auto sleep = std::min(g_config.wait_sleep_min << doublings, g_config.wait_sleep_max);
+    
+    std::this_thread::sleep_for(std::chrono::microseconds(sleep));
+}
+
+void my_mpi_progress()
+{
+#ifdef USE_AMPOLL
+    gasnet_AMPoll();
+#endif
+    shm_poll();
+    eager_poll();
+    background_sends_step();
+    rpc_execute();
+    termination_step();
 }
 
-my_mpi::my_mpi()
+my_mpi::my_mpi(const my_mpi_config &config)
 {    
     std::vector<gasnet_handlerentry_t> handlers = {
-        { 200, (void(*)())req_message_transfer },
-        { 201, (void(*)())rep_message_transfer },
+        { message_req_id,  (void(*)())req_message_transfer },
+        { message_rep_id,  (void(*)())rep_message_transfer },
+        { chunk_notify_id, (void(*)())chunk_notify_handler },
+        { chunk_credit_id, (void(*)())chunk_credit_handler },
+        { rpc_req_id,      (void(*)())rpc_request_handler },
+        { rpc_rep_id,      (void(*)())rpc_reply_handler },
+        { atomic_req_id,   (void(*)())atomic_request_handler },
+        { atomic_rep_id,   (void(*)())atomic_reply_handler },
+        { steal_req_id,    (void(*)())steal_request_handler },
+        { steal_rep_id,    (void(*)())steal_reply_handler },
+        { termination_token_id, (void(*)())termination_token_handler },
+        { termination_done_id,  (void(*)())termination_done_handler },
+        { object_call_id,  (void(*)())object_call_handler },
     };
     
+    g_config = config;
+    
     gasnet_init(nullptr, nullptr);
-    gasnet_attach(handlers.data(), handlers.size(), 16711680, 524288);
+    
+    // the node info is available before attach, the shm layout depends on it
+    g_nodeinfo.resize(gasnet_nodes());
+    gasnet_getNodeInfo(g_nodeinfo.data(), g_nodeinfo.size());
+    
+    // the chunk landing zones, shm rings and eager rings come on top of the requested segment
+    auto segment_size = g_config.segment_size + gasnet_nodes()*g_config.chunk_depth*g_config.chunk_size + shm_layout();
+    
+    if( g_config.use_eager_rdma )
+        segment_size += gasnet_nodes()*(g_config.eager_slots*round_up(g_config.eager_slot_size + 64, cache_line) + cache_line);
+    
+    segment_size = std::min<std::size_t>(round_up(segment_size, GASNET_PAGESIZE), gasnet_getMaxLocalSegmentSize());
+    
+    gasnet_attach(handlers.data(), handlers.size(), segment_size, g_config.min_heap_offset);
+    
+    g_seginfo.resize(gasnet_nodes());
+    gasnet_getSegmentInfo(g_seginfo.data(), g_seginfo.size());
+    
+    node_map_setup();
+    chunk_setup();
+    shm_setup();
+    eager_setup();
+    
+    // rings must be initialized before anybody writes to them
+    BARRIER();
 }
 
-void my_mpi::send_gasnet_request(int dest_node, int id, char* data, std::size_t size)
+void my_mpi::send_gasnet_request(int dest_node, int id, const char* data, std::size_t size)
 {
-    if( data == nullptr ) std::cout << "nullptr error" << std::endl;
-    gasnet_AMRequestMedium1(dest_node, 200, data, size, id);
+    if( data == nullptr && size != 0 ) std::cout << "nullptr error" << std::endl;
+    
+    // messages to this rank skip the network, the handler copy and the reply
+    if( dest_node == rank() )
+    {
+        deliver_message(id, data, size);
+        return;
+    }
+    
+    // note: as with AM, messages taking different paths are not ordered against each other
+    if( shm_send(dest_node, id, data, size) )
+        return;
+    
+    if( eager_send(dest_node, id, data, size) )
+        return;
+    
+    if( size > g_chunk_threshold )
+    {
+        chunked_send(dest_node, id, data, size);
+        return;
+    }
+    
+    gasnet_AMRequestMedium1(dest_node, message_req_id, const_cast<char *>(data), size, id);
     g_pending_messages++;
 }
 
-std::pair<char *, std::size_t> my_mpi::wait_for_message_arrival(int id)
+void my_mpi::send_iov(int dest_node, int id, const iovec_t* iov, std::size_t count)
+{
+    // a single piece needs no gathering
+    if( count == 1 )
+    {
+        send_gasnet_request(dest_node, id, static_cast<const char *>(iov[0].data), iov[0].size);
+        return;
+    }
+    
+    std::size_t total_size = 0;
+    for(std::size_t i=0; i<count; ++i)
+        total_size += iov[i].size;
+    
+    g_iov_buffer.resize(total_size);
+    
+    std::size_t offset = 0;
+    for(std::size_t i=0; i<count; ++i)
+    {
+        std::memcpy(g_iov_buffer.data() + offset, iov[i].data, iov[i].size);
+        offset += iov[i].size;
+    }
+    
+    send_gasnet_request(dest_node, id, g_iov_buffer.data(), total_size);
+}
+
+void my_mpi::send_iov(int dest_node, int id, std::initializer_list<iovec_t> iov)
+{
+    send_iov(dest_node, id, iov.begin(), iov.size());
+}
+
+bool my_mpi::poll_message(int id, const char *&data, std::size_t &size, std::size_t &available)
+{
+    progress();
+    
+    auto found = std::find_if(g_recv_messages.begin(), g_recv_messages.end(), [&](auto &msg){ return msg.id == id && !msg.posted; });
+    
+    if( found == g_recv_messages.end() )
+        return false;
+    
+    data = found->data;
+    size = found->size;
+    available = found->received == found->size ? found->size : std::min(found->size, found->chunks_contiguous*g_chunk_size);
+    
+    return true;
+}
+
+std::pair<char *, std::size_t> my_mpi::wait_for_message_arrival(int id, std::shared_ptr<my_mpi_detail::moved_buffer> *moved)
 {
     auto found = g_recv_messages.begin();
+    std::size_t polls = 0;
     
-    do
+    // the first message with this id, chunked messages must have arrived completely
+    while( true )
     {
-#ifdef USE_AMPOLL
-        gasnet_AMPoll();
-#endif
-        found = std::find_if(g_recv_messages.begin(), g_recv_messages.end(), [&](auto &msg){ return msg.id == id; });
+        progress();
+        found = std::find_if(g_recv_messages.begin(), g_recv_messages.end(), [&](auto &msg){ return msg.id == id && !msg.posted; });
+        
+        if( found != g_recv_messages.end() && found->received == found->size )
+            break;
+        
+        my_mpi_backoff(polls);
     }
-    while( found == g_recv_messages.end() );
     auto ret_val = std::make_pair(found->data, found->size);
     
+    if( found->moved )
+    {
+        if( moved != nullptr )
+        {
+            *moved = found->moved;
+        }
+        else
+        {
+            ret_val.first = new char[found->size];
+            std::memcpy(ret_val.first, found->data, found->size);
+        }
+    }
+    
     g_recv_messages.erase(found);
     
     return ret_val;
@@ -82,11 +1331,26 @@ std::pair<char *, std::size_t> my_mpi::wait_for_message_arrival(int id)
 
 my_mpi::~my_mpi()
 {
-    GASNET_BLOCKUNTIL(g_pending_messages == 0);
+    std::size_t polls = 0;
+    
+    while( g_pending_messages != 0 || !g_background_sends.empty() )
+    {
+        my_mpi_progress();
+        my_mpi_backoff(polls);
+    }
+    
     BARRIER();    
     gasnet_exit(0);
 }
 
+void my_mpi::exit(int code)
+{
+    gasnet_exit(code);
+    
+    // gasnet_exit does not return
+    std::abort();
+}
+
 int my_mpi::rank()
 {
     return gasnet_mynode();
@@ -104,8 +1368,314 @@ std::string my_mpi::hostename()
 
 void my_mpi::barrier()
 {
+    const auto tag = begin_collective();
+    const int me = rank();
+    
+    if( me != node_leader(me) )
+    {
+        send_gasnet_request(node_leader(me), tag, nullptr, 0);
+        delete[] wait_for_message_arrival(tag - 2).first;
+        return;
+    }
+    
+    for(std::size_t i=1; i<g_node_ranks.size(); ++i)
+        delete[] wait_for_message_arrival(tag).first;
+    
+    // dissemination among the leaders, one tag per round
+    const int n = g_node_leaders.size();
+    const int idx = std::find(g_node_leaders.begin(), g_node_leaders.end(), me) - g_node_leaders.begin();
+    
+    for(int dist = 1, round = 0; dist < n; dist <<= 1, ++round)
+    {
+        send_gasnet_request(g_node_leaders[(idx + dist) % n], tag - 3 - round, nullptr, 0);
+        delete[] wait_for_message_arrival(tag - 3 - round).first;
+    }
+    
+    for(auto node : g_node_ranks)
+        if( node != me )
+            send_gasnet_request(node, tag - 2, nullptr, 0);
+}
+
+int my_mpi::begin_collective()
+{
+    // 64 tags per collective, sequence numbers wrap long before they could be confused
+    return -1 - (g_collective_seq++ % 65536) * 64;
+}
+
+const std::vector<int> &my_mpi::node_ranks()
+{
+    return g_node_ranks;
+}
+
+const std::vector<int> &my_mpi::node_leaders()
+{
+    return g_node_leaders;
+}
+
+int my_mpi::node_leader(int node)
+{
+    return g_leader_of[node];
+}
+
+bool my_mpi::is_shm_peer(int node)
+{
+    return g_local_index[node] >= 0;
+}
+
+void my_mpi::progress()
+{
+    my_mpi_progress();
+}
+
+void my_mpi::send_rpc(int dest_node, my_mpi_rpc_invoker_t invoker, void (*fn)(), const char *args, std::size_t size, 
+                      std::function<void(const char *, std::size_t)> on_reply)
+{
+    if( size > gasnet_AMMaxMedium() )
+        throw std::runtime_error("rpc arguments must not be larger than gasnet_AMMaxMedium()");
+    
+    gasnet_handlerarg_t invoker_lo, invoker_hi, fn_lo, fn_hi;
+    split_pointer(reinterpret_cast<void (*)()>(invoker), invoker_lo, invoker_hi);
+    split_pointer(fn, fn_lo, fn_hi);
+    
+    const int reply_id = g_rpc_next_id++;
+    g_rpc_replies[reply_id] = std::move(on_reply);
+    
+    gasnet_AMRequestMedium5(dest_node, rpc_req_id, const_cast<char *>(args), size, invoker_lo, invoker_hi, fn_lo, fn_hi, reply_id);
+}
+
+
+
+
+std::size_t my_mpi::segment_alloc(std::size_t size)
+{
+    auto offset = segment_reserve(size);
+    
+    if( offset == SIZE_MAX )
+        throw std::runtime_error("my_mpi: segment exhausted, increase my_mpi_config::segment_size");
+    
+    std::memset(segment_address(rank(), offset), 0, size);
+    BARRIER();
+    
+    return offset;
+}
+
+void *my_mpi::segment_local(int node, std::size_t offset)
+{
+    if( node != rank() && g_local_index[node] < 0 )
+        return nullptr;
+    
+    return segment_address(node, offset);
+}
+
+my_future<void> my_mpi::get_bytes(void *dest, int node, std::size_t offset, std::size_t size)
+{
+    if( auto local = segment_local(node, offset) )
+    {
+        std::memcpy(dest, local, size);
+        return my_future<void>::make_ready();
+    }
+    
+    auto handle = gasnet_get_nb_bulk(dest, node, static_cast<char *>(g_seginfo[node].addr) + offset, size);
+    
+    my_future<void> future;
+    future.state()->test = [handle](){ return gasnet_try_syncnb(handle) == GASNET_OK; };
+    
+    return future;
+}
+
+my_future<void> my_mpi::put_bytes(int node, std::size_t offset, const void *src, std::size_t size)
+{
+    if( auto local = segment_local(node, offset) )
+    {
+        std::memcpy(local, src, size);
+        return my_future<void>::make_ready();
+    }
+    
+    // the non-bulk put has consumed src when it returns
+    auto handle = gasnet_put_nb(node, static_cast<char *>(g_seginfo[node].addr) + offset, const_cast<void *>(src), size);
+    
+    my_future<void> future;
+    future.state()->test = [handle](){ return gasnet_try_syncnb(handle) == GASNET_OK; };
+    
+    return future;
+}
+
+my_future<std::uint64_t> my_mpi::atomic(my_mpi_atomic_op op, int size, int node, std::size_t offset, std::uint64_t operand, std::uint64_t compare)
+{
+    if( size != 4 && size != 8 )
+        throw std::runtime_error("atomics are supported on 32 and 64 bit types only");
+    
+    if( auto local = segment_local(node, offset) )
+        return my_future<std::uint64_t>::make_ready(apply_atomic(local, static_cast<int>(op), size, operand, compare));
+    
+    my_future<std::uint64_t> future;
+    
+    const int reply_id = g_atomic_next_id++;
+    g_atomic_replies[reply_id] = future.state();
+    
+    atomic_request_t request = { offset, operand, compare, static_cast<int>(op), size, reply_id };
+    gasnet_AMRequestMedium0(node, atomic_req_id, &request, sizeof(request));
+    
+    return future;
+}
+
+void my_mpi::spawn_task(my_mpi_rpc_invoker_t invoker, void (*fn)(), const char *args, std::size_t size)
+{
+    g_tasks.push_back({ invoker, fn, std::vector<char>(args, args + size) });
+    g_tasks_created++;
+}
+
+void my_mpi::run_tasks(bool steal)
+{
+    std::vector<char> result;
+    std::size_t polls = 0;
+    std::mt19937 rng(rank());
+    std::uniform_int_distribution<int> other_rank(0, std::max(world_size() - 2, 0));
+    
+    BARRIER();
+    
+    g_tasks_running = true;
+    g_tasks_done = false;
+    g_token_here = false;
+    g_wave_in_flight = false;
+    g_last_wave_created = UINT64_MAX;
+    g_last_wave_executed = UINT64_MAX;
+    
+    while( !g_tasks_done )
+    {
+        if( !g_tasks.empty() )
+        {
+            auto task = std::move(g_tasks.back());
+            g_tasks.pop_back();
+            
+            task.invoker(task.fn, task.args.data(), result);
+            g_tasks_executed++;
+            polls = 0;
+            
+            // serve thieves between tasks
+            gasnet_AMPoll();
+            continue;
+        }
+        
+        if( steal && !g_steal_pending && world_size() > 1 )
+        {
+            auto victim = other_rank(rng);
+            if( victim >= rank() ) victim++;
+            
+            g_steal_pending = true;
+            g_steals_attempted++;
+            gasnet_AMRequestShort0(victim, steal_req_id);
+        }
+        
+        progress();
+        my_mpi_backoff(polls);
+    }
+    
+    g_tasks_running = false;
+    
+    // a late token must not leak into the next run
     BARRIER();
+    gasnet_AMPoll();
+    g_token_here = false;
+}
+
+void my_mpi::task_stats(std::uint64_t &executed, std::uint64_t &steals_attempted, std::uint64_t &steals_succeeded)
+{
+    executed = g_tasks_executed;
+    steals_attempted = g_steals_attempted;
+    steals_succeeded = g_steals_succeeded;
+}
+
+int my_mpi::register_object(void *object)
+{
+    g_objects.push_back(object);
+    return g_objects.size() - 1;
+}
+
+void my_mpi::unregister_object(int object_id)
+{
+    g_objects.at(object_id) = nullptr;
+}
+
+void my_mpi::call_object(int dest_node, my_mpi_object_invoker_t invoker, int object_id, const char *args, std::size_t size, 
+                         std::function<void(const char *, std::size_t)> on_reply)
+{
+    if( size > gasnet_AMMaxMedium() )
+        throw std::runtime_error("object call arguments must not be larger than gasnet_AMMaxMedium()");
+    
+    gasnet_handlerarg_t invoker_lo, invoker_hi;
+    split_pointer(reinterpret_cast<void (*)()>(invoker), invoker_lo, invoker_hi);
+    
+    const int reply_id = g_rpc_next_id++;
+    g_rpc_replies[reply_id] = std::move(on_reply);
+    
+    gasnet_AMRequestMedium4(dest_node, object_call_id, const_cast<char *>(args), size, invoker_lo, invoker_hi, object_id, reply_id);
 }
 
+std::size_t my_mpi::max_message_size()
+{
+    return gasnet_AMMaxMedium();
+}
 
+std::shared_ptr<my_mpi_posted_recv_t> my_mpi::post_recv(int id, char *buffer, std::size_t capacity)
+{
+    auto recv = std::make_shared<my_mpi_posted_recv_t>();
+    *recv = { id, buffer, capacity, 0, false, false };
+    
+    // an earlier message with this id has to be taken first
+    auto found = std::find_if(g_recv_messages.begin(), g_recv_messages.end(), [&](auto &msg){ return msg.id == id && !msg.posted; });
+    
+    if( found == g_recv_messages.end() )
+    {
+        g_posted_recvs.push_back(recv);
+        return recv;
+    }
+    
+    if( found->size > capacity )
+    {
+        recv->truncated = true;
+        return recv;
+    }
+    
+    // chunks of a message still in flight may arrive out of order, so the whole buffer is moved
+    std::memcpy(buffer, found->data, found->size);
+    
+    if( !found->moved )
+        delete[] found->data;
+    
+    // the rest of a chunked message goes straight to the buffer
+    if( found->received != found->size )
+    {
+        found->data = buffer;
+        found->posted = recv;
+        return recv;
+    }
+    
+    recv->size = found->size;
+    recv->done = true;
+    
+    g_recv_messages.erase(found);
+    
+    return recv;
+}
 
+void my_mpi::send_moved(int dest_node, int id, std::shared_ptr<my_mpi_detail::moved_buffer> buffer, const char *data, std::size_t size)
+{
+    if( dest_node == rank() )
+    {
+        deliver_message(id, data, size, std::move(buffer));
+        return;
+    }
+    
+    // all paths but the chunked one are done with the data when they return, the buffer is freed with it
+    if( size <= g_chunk_threshold || (g_local_index[dest_node] >= 0 && size <= g_config.shm_bounce_size) )
+    {
+        send_gasnet_request(dest_node, id, data, size);
+        return;
+    }
+    
+    g_background_sends.push_back( chunked_begin(dest_node, id, data, size) );
+    g_background_sends.back().owner = std::move(buffer);
+    
+    background_sends_step();
+}
@@ -9,6 +9,18 @@
 #include <utility>
 #include <cstddef>
 #include <iostream>
+#include <initializer_list>
+#include <type_traits>
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+
+#include "my_future.hpp"
 
 #ifndef GASNET_CONDUIT_ARIES
 #define USE_AMPOLL
@@ -17,41 +29,624 @@
 #define USE_AMPOLL
 #endif
 
+// how blocking calls wait, see my_mpi_config
+enum class my_mpi_wait_policy : int
+{
+    spin,           // poll continuously, lowest latency
+    spin_yield,     // poll wait_spins times, then yield the core after every poll
+    spin_sleep      // poll wait_spins times, then sleep between polls with exponential backoff
+};
+
+struct my_mpi_config
+{
+    std::size_t segment_size    = 16711680;
+    std::size_t min_heap_offset = 524288;
+    
+    // shared-memory transport between ranks of the same GASNet supernode (needs PSHM)
+    bool use_shm                = true;
+    std::size_t shm_ring_slots  = 16;       // slots per pair of ranks
+    std::size_t shm_slot_size   = 1024;     // payload bytes inlined into a slot
+    std::size_t shm_bounce_size = 32768;    // larger messages take the AM path
+    std::size_t shm_bounce_slots = 4;       // bounce buffers per pair of ranks, i.e. large messages in flight
+    
+    // messages above chunk_threshold (0: gasnet_AMMaxMedium()) are put in pipelined chunks
+    std::size_t chunk_threshold = 0;
+    std::size_t chunk_size      = 65536;
+    std::size_t chunk_depth     = 2;        // chunks in flight per pair of ranks
+    
+    /*
+     * small messages to ranks outside the supernode are put into per-pair rings of the receiver.
+     * off by default: every message takes two blocking puts (payload, then sequence number),
+     * which is not shown to beat one AM Medium; measure with pingpong_my_mpi before enabling.
+     */
+    bool use_eager_rdma         = false;
+    std::size_t eager_slots     = 16;       // slots per pair of ranks, credits return every eager_slots/2
+    std::size_t eager_slot_size = 256;      // payload bytes per slot, larger messages take the AM path
+    
+    // waiting in recv_data, futures, barriers, ... ; the first wait_spins polls never back off
+    my_mpi_wait_policy wait_policy = my_mpi_wait_policy::spin;
+    std::size_t wait_spins      = 10000;
+    std::size_t wait_sleep_min  = 1;        // microseconds, doubled after every poll
+    std::size_t wait_sleep_max  = 1000;
+};
+
+// operations of my_mpi::atomic(), see atomic_domain.hpp
+enum class my_mpi_atomic_op : int
+{
+    load, store, exchange, fetch_add, fetch_and, fetch_or, fetch_xor, compare_exchange
+};
+
+// receive buffer registered before the message arrives, see my_mpi::irecv()
+struct my_mpi_posted_recv_t
+{
+    int id;
+    char *buffer;
+    std::size_t capacity;
+    std::size_t size;
+    bool done;
+    bool truncated;     // the matching message did not fit, it stays unexpected
+};
+
+// executes a serialised rpc, see my_mpi::rpc()
+typedef void (*my_mpi_rpc_invoker_t)(void (*fn)(), const char *args, std::vector<char> &result);
+
+// runs inside the AM handler on a registered object, see my_mpi::call_object()
+typedef void (*my_mpi_object_invoker_t)(void *object, const char *args, std::size_t size, std::vector<char> &reply);
+
+namespace my_mpi_detail
+{
+    // buffer of a message handed over by std::move instead of being copied, see my_mpi::send_data
+    struct moved_buffer
+    {
+        virtual ~moved_buffer() {}
+    };
+    
+    template<typename T>
+    struct moved_vector : moved_buffer
+    {
+        moved_vector(std::vector<T> &&_data) : data(std::move(_data)) {}
+        std::vector<T> data;
+    };
+    
+    template<typename T>
+    inline void rpc_store(char *&buf, const T &value)
+    {
+        static_assert( std::is_trivially_copyable<T>::value, "rpc arguments must be trivially copyable" );
+        std::memcpy(buf, &value, sizeof(T));
+        buf += sizeof(T);
+    }
+    
+    template<typename ... T> struct rpc_args_size { static constexpr std::size_t value = 0; };
+    
+    template<typename T, typename ... rest_t> 
+    struct rpc_args_size<T, rest_t...> { static constexpr std::size_t value = sizeof(T) + rpc_args_size<rest_t...>::value; };
+    
+    template<typename tuple_t, std::size_t ... I>
+    inline void rpc_store_all(char *&buf, const tuple_t &values, std::index_sequence<I...>)
+    {
+        int expand[] = { 0, (rpc_store(buf, std::get<I>(values)), 0)... };
+        (void)expand;
+    }
+    
+    template<typename T>
+    inline T rpc_load(const char *&buf)
+    {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        std::memcpy(&storage, buf, sizeof(T));
+        buf += sizeof(T);
+        return *reinterpret_cast<T *>(&storage);
+    }
+    
+    template<typename R, typename ... params_t>
+    struct rpc_call
+    {
+        template<std::size_t ... I>
+        static R call(R (*fn)(params_t...), std::tuple<std::decay_t<params_t>...> &args, std::index_sequence<I...>)
+        {
+            return fn(std::get<I>(args)...);
+        }
+        
+        static void invoke(void (*fn)(), const char *buf, std::vector<char> &result)
+        {
+            static_assert( std::is_trivially_copyable<R>::value, "rpc results must be trivially copyable" );
+            
+            // braced initialisation evaluates the loads from left to right
+            std::tuple<std::decay_t<params_t>...> args{ rpc_load<std::decay_t<params_t>>(buf)... };
+            R value = call(reinterpret_cast<R (*)(params_t...)>(fn), args, std::index_sequence_for<params_t...>());
+            
+            result.resize(sizeof(R));
+            std::memcpy(result.data(), &value, sizeof(R));
+        }
+    };
+    
+    template<typename ... params_t>
+    struct rpc_call<void, params_t...>
+    {
+        template<std::size_t ... I>
+        static void call(void (*fn)(params_t...), std::tuple<std::decay_t<params_t>...> &args, std::index_sequence<I...>)
+        {
+            fn(std::get<I>(args)...);
+        }
+        
+        static void invoke(void (*fn)(), const char *buf, std::vector<char> &result)
+        {
+            std::tuple<std::decay_t<params_t>...> args{ rpc_load<std::decay_t<params_t>>(buf)... };
+            call(reinterpret_cast<void (*)(params_t...)>(fn), args, std::index_sequence_for<params_t...>());
+            
+            result.clear();
+        }
+    };
+    
+    template<typename T>
+    inline void rpc_fulfill(typename my_future<T>::state_t &state, const char *buf, std::size_t)
+    {
+        std::memcpy(&state.value, buf, sizeof(T));
+        state.ready = true;
+    }
+    
+    template<>
+    inline void rpc_fulfill<void>(my_future<void>::state_t &state, const char *, std::size_t)
+    {
+        state.ready = true;
+    }
+}
+
 class my_mpi
 {
 public:
-    my_mpi();
+    my_mpi(const my_mpi_config &config = my_mpi_config());
     ~my_mpi();
     
+    // ends all ranks at once with code, without the final barrier of the destructor
+    [[noreturn]] void exit(int code);
+    
     int rank();
     int world_size();
     std::string hostename();
     
-    template<typename datatype_t> void send_data(int dest_node, int id, std::vector<datatype_t> &data);
+    // true if node shares memory with this rank and messages to it bypass the AM layer
+    bool is_shm_peer(int node);
+    
+    // node map built from the GASNet node info: ranks on this host and the leader (lowest rank) of every host
+    const std::vector<int> &node_ranks();
+    const std::vector<int> &node_leaders();
+    int node_leader(int node);
+    
+    // polls the network and the shared-memory rings once
+    void progress();
+    
+    // one piece of a vectored send, see send_iov()
+    struct iovec_t
+    {
+        const void *data;
+        std::size_t size;
+    };
+    
+    template<typename datatype_t> static iovec_t make_iov(const datatype_t *data, std::size_t count);
+    template<typename container_t> static iovec_t make_iov(const container_t &data);
+    
+    // any contiguous container with data() and size() (std::vector, std::array, std::string, ...)
+    template<typename container_t> void send_data(int dest_node, int id, const container_t &data);
+    template<typename datatype_t> void send_data(int dest_node, int id, const datatype_t *data, std::size_t count);
+    
+    /*
+     * takes ownership of data and returns without waiting for a chunked transfer, the buffer is 
+     * freed once the network is done with it. a message to this rank keeps the vector itself, 
+     * recv_data<datatype_t> returns it without a copy.
+     */
+    template<typename datatype_t> void send_data(int dest_node, int id, std::vector<datatype_t> &&data);
+    
     template<typename datatype_t> std::vector<datatype_t> recv_data(int id);
     
+    // like recv_data, but calls consume(const datatype_t *data, std::size_t count, std::size_t first) 
+    // for every piece of a chunked message as soon as it has landed
+    template<typename datatype_t, typename consume_t> std::vector<datatype_t> recv_data_chunked(int id, consume_t consume);
+    
+    /*
+     * posts data (room for count elements) as the receive buffer of the next message with id. 
+     * if it is posted before the message arrives, the payload is copied there directly by the 
+     * handler (or chunk by chunk from the landing zone), otherwise it is taken from the queue 
+     * of unexpected messages. the future holds the number of elements received and throws 
+     * if the message is larger than the buffer; that message can still be taken by recv_data.
+     * data must stay valid until the future is ready.
+     */
+    template<typename datatype_t> my_future<std::size_t> irecv(int id, datatype_t *data, std::size_t count);
+    template<typename datatype_t> std::size_t recv_data(int id, datatype_t *data, std::size_t count);
+    
+    /*
+     * sends to dest_node and receives the message with recv_id. the receive is posted first, 
+     * so the payload lands directly in recv (of capacity recv_count) and does not pass through 
+     * the unexpected queue. returns the number of elements received.
+     */
+    template<typename datatype_t> 
+    std::size_t sendrecv(int dest_node, int send_id, const datatype_t *send, std::size_t send_count, 
+                         int recv_id, datatype_t *recv, std::size_t recv_count);
+    
+    // recv is shrunk to the received size, its size on entry is the capacity
+    template<typename container_t, typename datatype_t> 
+    void sendrecv(int dest_node, int send_id, const container_t &send, int recv_id, std::vector<datatype_t> &recv);
+    
+    // sends data and replaces its contents with the received message (of at most the same size)
+    template<typename datatype_t> 
+    void sendrecv_replace(int dest_node, int send_id, int recv_id, std::vector<datatype_t> &data);
+    
+    // gathers all pieces into one message, the receiver sees their concatenation
+    void send_iov(int dest_node, int id, const iovec_t *iov, std::size_t count);
+    void send_iov(int dest_node, int id, std::initializer_list<iovec_t> iov);
+    
+    /*
+     * collectives are two-level: the ranks of a host combine at their leader (through 
+     * shared memory if possible), only the leaders communicate across hosts.
+     * negative message ids are reserved for them. reduction operators must be commutative.
+     */
     void barrier();
+    template<typename datatype_t> void bcast(std::vector<datatype_t> &data, int root);
+    template<typename datatype_t, typename op_t> void reduce(std::vector<datatype_t> &data, op_t op, int root);
+    template<typename datatype_t, typename op_t> void allreduce(std::vector<datatype_t> &data, op_t op);
+    
+    /*
+     * runs fn(args...) on dest_node and returns its result. the call is executed in the 
+     * target's progress() outside of any AM handler, so fn may communicate itself.
+     * fn must be a plain function (or a captureless lambda converted with +) of the same 
+     * executable on all ranks, arguments and result must be trivially copyable.
+     */
+    template<typename R, typename ... params_t, typename ... args_t>
+    my_future<R> rpc(int dest_node, R (*fn)(params_t...), args_t&& ... args);
+    
+    /*
+     * one-sided access to the segments. segment_alloc() is collective, all ranks must call it 
+     * in the same order with the same size. it returns zeroed memory at an offset that is valid 
+     * on every rank and lives as long as my_mpi.
+     */
+    std::size_t segment_alloc(std::size_t size);
+    void *segment_local(int node, std::size_t offset);   // this rank and shm peers, nullptr otherwise
+    my_future<void> get_bytes(void *dest, int node, std::size_t offset, std::size_t size);
+    my_future<void> put_bytes(int node, std::size_t offset, const void *src, std::size_t size);
+    
+    // atomic operation on a 4 or 8 byte word of a segment, returns the old value
+    my_future<std::uint64_t> atomic(my_mpi_atomic_op op, int size, int node, std::size_t offset, std::uint64_t operand, std::uint64_t compare = 0);
+    
+    /*
+     * distributed task pool, see task_pool.hpp for the typed interface. run_tasks() is 
+     * collective and returns once no rank has tasks left.
+     */
+    void spawn_task(my_mpi_rpc_invoker_t invoker, void (*fn)(), const char *args, std::size_t size);
+    void run_tasks(bool steal = true);
+    void task_stats(std::uint64_t &executed, std::uint64_t &steals_attempted, std::uint64_t &steals_succeeded);
+    
+    /*
+     * distributed objects: register_object() is collective and must happen in the same order on 
+     * all ranks. call_object() runs invoker on the peer's instance inside the AM handler (so it 
+     * must not communicate) and hands its reply to on_reply during a later progress().
+     * unregister_object() must follow the last call on the object from any rank (e.g. after a 
+     * barrier), ids are not reused.
+     */
+    int register_object(void *object);
+    void unregister_object(int object_id);
+    void call_object(int dest_node, my_mpi_object_invoker_t invoker, int object_id, const char *args, std::size_t size, 
+                     std::function<void(const char *, std::size_t)> on_reply);
+    
+    // largest payload of a single AM (arguments of rpc and call_object, replies)
+    std::size_t max_message_size();
     
 private:
-    void send_gasnet_request(int dest_node, int id, char *data, std::size_t size);
-    std::pair<char *, std::size_t> wait_for_message_arrival(int id);
+    void send_rpc(int dest_node, my_mpi_rpc_invoker_t invoker, void (*fn)(), const char *args, std::size_t size, 
+                  std::function<void(const char *, std::size_t)> on_reply);
+    int begin_collective();
+    template<typename datatype_t> void recv_into(int id, std::vector<datatype_t> &data);
+    template<typename datatype_t, typename op_t> void recv_combine(int id, std::vector<datatype_t> &data, op_t op);
+    
+
+    void send_gasnet_request(int dest_node, int id, const char *data, std::size_t size);
+    void send_moved(int dest_node, int id, std::shared_ptr<my_mpi_detail::moved_buffer> buffer, const char *data, std::size_t size);
+    
+    // the data is owned by moved if that is set, otherwise it has to be freed with delete[]
+    std::pair<char *, std::size_t> wait_for_message_arrival(int id, std::shared_ptr<my_mpi_detail::moved_buffer> *moved = nullptr);
+    std::shared_ptr<my_mpi_posted_recv_t> post_recv(int id, char *buffer, std::size_t capacity);
+    bool poll_message(int id, const char *&data, std::size_t &size, std::size_t &available);
 };
     
 template<typename datatype_t>
-auto my_mpi::send_data(int dest_node, int id, std::vector<datatype_t> &data) -> void
+auto my_mpi::make_iov(const datatype_t *data, std::size_t count) -> iovec_t
+{
+    static_assert( std::is_trivially_copyable<datatype_t>::value, "datatype must be trivially copyable" );
+    
+    return { data, count*sizeof(datatype_t) };
+}
+
+template<typename container_t>
+auto my_mpi::make_iov(const container_t &data) -> iovec_t
 {
-    send_gasnet_request(dest_node, id, reinterpret_cast<char *>(data.data()), data.size()*sizeof(datatype_t) );
+    return make_iov(data.data(), data.size());
+}
+
+template<typename container_t>
+auto my_mpi::send_data(int dest_node, int id, const container_t &data) -> void
+{
+    send_data(dest_node, id, data.data(), data.size());
+}
+
+template<typename datatype_t>
+auto my_mpi::send_data(int dest_node, int id, const datatype_t *data, std::size_t count) -> void
+{
+    static_assert( std::is_trivially_copyable<datatype_t>::value, "datatype must be trivially copyable" );
+    
+    send_gasnet_request(dest_node, id, reinterpret_cast<const char *>(data), count*sizeof(datatype_t) );
 }
     
+template<typename datatype_t>
+auto my_mpi::send_data(int dest_node, int id, std::vector<datatype_t> &&data) -> void
+{
+    static_assert( std::is_trivially_copyable<datatype_t>::value, "datatype must be trivially copyable" );
+    
+    auto moved = std::make_shared<my_mpi_detail::moved_vector<datatype_t>>(std::move(data));
+    send_moved(dest_node, id, moved, reinterpret_cast<const char *>(moved->data.data()), moved->data.size()*sizeof(datatype_t));
+}
+
 template<typename datatype_t>
 auto my_mpi::recv_data(int id) -> std::vector<datatype_t>
 {
-    auto msg_data = wait_for_message_arrival(id);
+    std::shared_ptr<my_mpi_detail::moved_buffer> moved;
+    auto msg_data = wait_for_message_arrival(id, &moved);
     
     auto ptr = reinterpret_cast<datatype_t *>(msg_data.first);
     auto size = msg_data.second / sizeof(datatype_t);
     
-    return std::move(std::vector<datatype_t>(ptr, ptr+size));
+    if( moved )
+    {
+        // sent by this rank as a std::vector of the same type: hand it back
+        if( auto vector = dynamic_cast<my_mpi_detail::moved_vector<datatype_t> *>(moved.get()) )
+            return std::move(vector->data);
+        
+        return std::vector<datatype_t>(ptr, ptr+size);
+    }
+    
+    std::vector<datatype_t> data(ptr, ptr+size);
+    delete[] msg_data.first;
+    
+    return data;
+}
+
+template<typename datatype_t>
+auto my_mpi::irecv(int id, datatype_t *data, std::size_t count) -> my_future<std::size_t>
+{
+    static_assert( std::is_trivially_copyable<datatype_t>::value, "datatype must be trivially copyable" );
+    
+    auto posted = post_recv(id, reinterpret_cast<char *>(data), count*sizeof(datatype_t));
+    
+    my_future<std::size_t> future;
+    auto state = future.state();
+    
+    state->test = [state, posted]()
+    {
+        if( posted->truncated )
+            throw std::runtime_error("my_mpi: message larger than the receive buffer");
+        
+        if( !posted->done )
+            return false;
+        
+        state->value = posted->size / sizeof(datatype_t);
+        return true;
+    };
+    
+    return future;
+}
+
+template<typename datatype_t>
+auto my_mpi::recv_data(int id, datatype_t *data, std::size_t count) -> std::size_t
+{
+    return irecv(id, data, count).get();
+}
+
+template<typename datatype_t>
+auto my_mpi::sendrecv(int dest_node, int send_id, const datatype_t *send, std::size_t send_count, 
+                      int recv_id, datatype_t *recv, std::size_t recv_count) -> std::size_t
+{
+    auto received = irecv(recv_id, recv, recv_count);
+    send_data(dest_node, send_id, send, send_count);
+    
+    return received.get();
+}
+
+template<typename container_t, typename datatype_t>
+auto my_mpi::sendrecv(int dest_node, int send_id, const container_t &send, int recv_id, std::vector<datatype_t> &recv) -> void
+{
+    recv.resize( sendrecv(dest_node, send_id, send.data(), send.size(), recv_id, recv.data(), recv.size()) );
+}
+
+template<typename datatype_t>
+auto my_mpi::sendrecv_replace(int dest_node, int send_id, int recv_id, std::vector<datatype_t> &data) -> void
+{
+    // the send has consumed the buffer when it returns, only then may the receive land in it
+    send_data(dest_node, send_id, data);
+    data.resize( recv_data(recv_id, data.data(), data.size()) );
+}
+
+template<typename datatype_t, typename consume_t>
+auto my_mpi::recv_data_chunked(int id, consume_t consume) -> std::vector<datatype_t>
+{
+    const char *data = nullptr;
+    std::size_t size = 0, available = 0, delivered = 0, polls = 0;
+    
+    do
+    {
+        if( !poll_message(id, data, size, available) )
+        {
+            my_mpi_backoff(polls);
+            continue;
+        }
+        
+        auto ptr = reinterpret_cast<const datatype_t *>(data);
+        auto count = available / sizeof(datatype_t);
+        
+        if( count > delivered )
+        {
+            consume(ptr + delivered, count - delivered, delivered);
+            delivered = count;
+            polls = 0;
+        }
+        else
+        {
+            my_mpi_backoff(polls);
+        }
+    }
+    while( data == nullptr || available != size );
+    
+    return recv_data<datatype_t>(id);
+}
+
+template<typename R, typename ... params_t, typename ... args_t>
+auto my_mpi::rpc(int dest_node, R (*fn)(params_t...), args_t&& ... args) -> my_future<R>
+{
+    static_assert( sizeof...(params_t) == sizeof...(args_t), "wrong number of rpc arguments" );
+    
+    // convert to the parameter types first, so the target reads exactly what was written
+    std::tuple<std::decay_t<params_t>...> converted{ std::forward<args_t>(args)... };
+    
+    char buffer[my_mpi_detail::rpc_args_size<std::decay_t<params_t>...>::value + 1];
+    char *pos = buffer;
+    my_mpi_detail::rpc_store_all(pos, converted, std::index_sequence_for<params_t...>());
+    
+    my_future<R> future;
+    auto state = future.state();
+    
+    send_rpc(dest_node, &my_mpi_detail::rpc_call<R, params_t...>::invoke, reinterpret_cast<void (*)()>(fn), buffer, pos - buffer, 
+             [state](const char *buf, std::size_t size){ my_mpi_detail::rpc_fulfill<R>(*state, buf, size); });
+    
+    return future;
+}
+
+template<typename datatype_t>
+auto my_mpi::recv_into(int id, std::vector<datatype_t> &data) -> void
+{
+    auto msg_data = wait_for_message_arrival(id);
+    auto ptr = reinterpret_cast<datatype_t *>(msg_data.first);
+    
+    data.assign(ptr, ptr + msg_data.second / sizeof(datatype_t));
+    delete[] msg_data.first;
+}
+
+template<typename datatype_t, typename op_t>
+auto my_mpi::recv_combine(int id, std::vector<datatype_t> &data, op_t op) -> void
+{
+    auto msg_data = wait_for_message_arrival(id);
+    auto ptr = reinterpret_cast<datatype_t *>(msg_data.first);
+    
+    // every rank must contribute a vector of the same length
+    if( msg_data.second != data.size()*sizeof(datatype_t) )
+    {
+        delete[] msg_data.first;
+        throw std::runtime_error("my_mpi: reduce contributions differ in size (" + std::to_string(msg_data.second / sizeof(datatype_t))
+                                 + " vs " + std::to_string(data.size()) + " elements)");
+    }
+    
+    for(std::size_t i=0; i<data.size(); ++i)
+        data[i] = op(data[i], ptr[i]);
+    
+    delete[] msg_data.first;
+}
+
+template<typename datatype_t>
+auto my_mpi::bcast(std::vector<datatype_t> &data, int root) -> void
+{
+    const auto tag = begin_collective();
+    const auto &leaders = node_leaders();
+    const int me = rank();
+    const int my_leader = node_leader(me);
+    const int root_leader = node_leader(root);
+    
+    // hand the data to the leader of the root's host
+    if( root != root_leader )
+    {
+        if( me == root ) send_data(root_leader, tag, data);
+        if( me == root_leader ) recv_into(tag, data);
+    }
+    
+    // binomial tree among the leaders
+    if( me == my_leader )
+    {
+        const int n = leaders.size();
+        const int root_idx = std::find(leaders.begin(), leaders.end(), root_leader) - leaders.begin();
+        const int rel = (std::find(leaders.begin(), leaders.end(), me) - leaders.begin() - root_idx + n) % n;
+        
+        int mask = 1;
+        for(; mask < n; mask <<= 1)
+        {
+            if( rel & mask )
+            {
+                recv_into(tag - 1, data);
+                break;
+            }
+        }
+        
+        for(mask >>= 1; mask > 0; mask >>= 1)
+            if( rel + mask < n )
+                send_data(leaders[(rel + mask + root_idx) % n], tag - 1, data);
+        
+        // fan out on the host
+        for(auto node : node_ranks())
+            if( node != me && node != root )
+                send_data(node, tag - 2, data);
+    }
+    else if( me != root )
+    {
+        recv_into(tag - 2, data);
+    }
+}
+
+template<typename datatype_t, typename op_t>
+auto my_mpi::reduce(std::vector<datatype_t> &data, op_t op, int root) -> void
+{
+    const auto tag = begin_collective();
+    const auto &leaders = node_leaders();
+    const int me = rank();
+    const int my_leader = node_leader(me);
+    const int root_leader = node_leader(root);
+    
+    if( me != my_leader )
+    {
+        send_data(my_leader, tag, data);
+    }
+    else
+    {
+        // combine the host's contributions
+        for(std::size_t i=1; i<node_ranks().size(); ++i)
+            recv_combine(tag, data, op);
+        
+        // binomial tree among the leaders towards the root's leader
+        const int n = leaders.size();
+        const int root_idx = std::find(leaders.begin(), leaders.end(), root_leader) - leaders.begin();
+        const int rel = (std::find(leaders.begin(), leaders.end(), me) - leaders.begin() - root_idx + n) % n;
+        
+        for(int mask = 1; mask < n; mask <<= 1)
+        {
+            if( rel & mask )
+            {
+                send_data(leaders[(rel - mask + root_idx) % n], tag - 1, data);
+                break;
+            }
+            
+            if( rel + mask < n )
+                recv_combine(tag - 1, data, op);
+        }
+    }
+    
+    // hand the result to the root
+    if( root != root_leader )
+    {
+        if( me == root_leader ) send_data(root, tag - 2, data);
+        if( me == root ) recv_into(tag - 2, data);
+    }
+}
+
+template<typename datatype_t, typename op_t>
+auto my_mpi::allreduce(std::vector<datatype_t> &data, op_t op) -> void
+{
+    // rooting at a leader saves the hand-off on both ends
+    const int root = node_leaders().front();
+    
+    reduce(data, op, root);
+    bcast(data, root);
 }
 
 #endif // MY_MPI_H
@@ -0,0 +1,48 @@
+/*
+ * distributed work-stealing task pool
+ */
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <tuple>
+#include <cstdint>
+
+#include "my_mpi.hpp"
+
+/*
+ * every rank runs the tasks of its own deque, idle ranks steal from random victims.
+ * tasks are plain functions (or captureless lambdas converted with +) with trivially
+ * copyable arguments, like my_mpi::rpc(). they may spawn further tasks.
+ */
+class task_pool
+{
+public:
+    task_pool(my_mpi &mpi) : m_mpi(mpi) {}
+    
+    template<typename ... params_t, typename ... args_t>
+    void spawn(void (*fn)(params_t...), args_t&& ... args)
+    {
+        static_assert( sizeof...(params_t) == sizeof...(args_t), "wrong number of task arguments" );
+        
+        std::tuple<std::decay_t<params_t>...> converted{ std::forward<args_t>(args)... };
+        
+        char buffer[my_mpi_detail::rpc_args_size<std::decay_t<params_t>...>::value + 1];
+        char *pos = buffer;
+        my_mpi_detail::rpc_store_all(pos, converted, std::index_sequence_for<params_t...>());
+        
+        m_mpi.spawn_task(&my_mpi_detail::rpc_call<void, params_t...>::invoke, reinterpret_cast<void (*)()>(fn), buffer, pos - buffer);
+    }
+    
+    // collective, returns once all tasks on all ranks are done
+    void run(bool steal = true) { m_mpi.run_tasks(steal); }
+    
+    std::uint64_t executed() { std::uint64_t e, a, s; m_mpi.task_stats(e, a, s); return e; }
+    std::uint64_t steals_attempted() { std::uint64_t e, a, s; m_mpi.task_stats(e, a, s); return a; }
+    std::uint64_t steals_succeeded() { std::uint64_t e, a, s; m_mpi.task_stats(e, a, s); return s; }
+    
+private:
+    my_mpi &m_mpi;
+};
+
+#endif // TASK_POOL_H
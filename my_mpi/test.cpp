@@ -1,7 +1,29 @@
 #include <iostream>
 #include <numeric>
+#include <functional>
+#include <stdexcept>
 #include "my_mpi.hpp"
 
+int remote_square(int x)
+{
+    return x*x;
+}
+
+// the data rank sends in every exchange below
+std::vector<double> rank_data(std::size_t size, int rank)
+{
+    std::vector<double> data(size);
+    std::iota(data.begin(), data.end(), size*rank);
+    
+    return data;
+}
+
+void check(const std::vector<double> &got, const std::vector<double> &expected, const char *what)
+{
+    if( got != expected )
+        throw std::runtime_error(std::string("test.cpp: wrong data after ") + what);
+}
+
 int main(int argc, char **argv) 
 {
     my_mpi mpi;
@@ -18,11 +40,11 @@ int main(int argc, char **argv)
     int right_rank = (rank + 1) % mpi.world_size();
     int left_rank = (rank - 1 + mpi.world_size()) % mpi.world_size();
     
-    std::vector<double> a(array_size);
-    std::iota(a.begin(), a.end(), array_size*rank);
+    auto a = rank_data(array_size, rank);
+    std::vector<double> b(array_size);
     
-    mpi.send_data(right_rank, 10, a);
-    auto b = mpi.recv_data<double>(10);
+    mpi.sendrecv(right_rank, 10, a, 10, b);
+    check(b, rank_data(array_size, left_rank), "sendrecv");
     
     std::cout << "Rank #" << rank << " recieved data from rank #" << left_rank << std::endl;
 
@@ -31,4 +53,53 @@ int main(int argc, char **argv)
 	std::cout << "data = [ "; 
     	for(auto el : b) { std::cout  << el << " "; } std::cout << "]" << std::endl;
     }
+    
+    // above the eager slot and above one AM Medium, so the eager, shm and chunked paths all run
+    std::vector<std::size_t> sizes = { std::size_t(array_size), 300, 4*mpi.max_message_size()/sizeof(double) + 3 };
+    
+    for(auto size : sizes)
+    {
+        auto expected = rank_data(size, left_rank);
+        
+        auto c = rank_data(size, rank);
+        mpi.sendrecv_replace(right_rank, 11, 11, c);
+        check(c, expected, "sendrecv_replace");
+        
+        // receive posted before the message is sent
+        std::vector<double> d(size);
+        auto received = mpi.irecv(12, d.data(), d.size());
+        mpi.barrier();
+        mpi.send_data(right_rank, 12, rank_data(size, rank));
+        
+        if( received.get() != size )
+            throw std::runtime_error("test.cpp: wrong size after irecv");
+        
+        check(d, expected, "irecv");
+        
+        mpi.send_data(rank, 13, rank_data(size, rank));
+        check(mpi.recv_data<double>(13), rank_data(size, rank), "self send");
+        
+        mpi.send_data(right_rank, 14, rank_data(size, rank));    // a temporary, sent without a copy
+        check(mpi.recv_data<double>(14), expected, "moved send");
+        
+        mpi.barrier();
+    }
+    
+    std::vector<int> rank_sum = { rank };
+    mpi.allreduce(rank_sum, std::plus<int>());
+    
+    if( rank_sum.front() != mpi.world_size()*(mpi.world_size() - 1)/2 )
+        throw std::runtime_error("test.cpp: wrong sum after allreduce");
+    
+    if( rank == 0 )
+        std::cout << "sum of all ranks = " << rank_sum.front() << " (" << mpi.node_leaders().size() << " hosts)" << std::endl;
+    
+    auto square = mpi.rpc(right_rank, &remote_square, rank);
+    
+    if( square.get() != rank*rank )
+        throw std::runtime_error("test.cpp: wrong result of rpc");
+    
+    std::cout << "Rank #" << rank << " got " << square.get() << " from rank #" << right_rank << " via rpc" << std::endl;
+    
+    mpi.barrier();
 }
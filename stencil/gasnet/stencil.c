@@ -580,4 +580,6 @@ static void displayPreamble(int num_procs, int n, int radius, int num_procsx, in
   printf("Compact representation of stencil loop body\n");
 #endif
   printf("Number of iterations   = %d\n", iterations);
+  printf("Timer                  = %s, overhead %.1f ns, resolution %.1f ns\n",
+         wtime_name(), 1.0E09 * wtime_overhead(), 1.0E09 * wtime_resolution());
 }
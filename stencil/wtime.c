@@ -40,38 +40,44 @@ Arguments: None
 
 Returns:   The wall clock time in seconds as a double is returned. 
 
-Notes:     This function uses two structures defined in the UNIX
-           system call, gettimeofday(2). The structure, "timeval" 
-           is defined in the include file <sys/time.h> as:
-
-                 struct timeval {
-                     long tv_sec;
-                     long tv_usec;
-                 }
-
-           where timeval.tv_sec is the seconds and timeval.tv_usec
-           is the microseconds.  
+Notes:     This function reads the calibrated clock of include/timer.h:
+           the TSC where it runs at a constant rate, otherwise
+           clock_gettime(CLOCK_MONOTONIC). Unlike gettimeofday(2)
+           neither jumps with changes of the system time, and both
+           resolve well below a microsecond. The reference point is
+           the first call.
  
 History:   Written by Tim Mattson, Dec 1, 1988
            Modified by Rob van der Wijngaart, May 2006, to change
            default clock to the Unix system clock.
+           Modified to use the calibrated monotonic clock shared
+           with the micro benchmarks.
 
 ****************************************************************/
 
-#include <stdlib.h>
-
-#include <sys/time.h>
-#define  USEC_TO_SEC   1.0e-6    /* to convert microsecs to secs */
+#include "../include/timer.h"
 
 double wtime() {
-  double time_seconds;
+  timer_init();
+
+  return timer_seconds();
+}
+
+/* the clock behind wtime, and its cost and step per reading in seconds */
+const char *wtime_name() {
+  timer_init();
+
+  return timer_name();
+}
+
+double wtime_overhead() {
+  timer_init();
+
+  return timer_state.overhead;
+}
 
-  struct timeval  time_data; /* seconds since 0 GMT */
-   
-  gettimeofday(&time_data,NULL);
-   
-  time_seconds  = (double) time_data.tv_sec;
-  time_seconds += (double) time_data.tv_usec * USEC_TO_SEC;
+double wtime_resolution() {
+  timer_init();
 
-  return time_seconds;
+  return timer_state.resolution;
 }